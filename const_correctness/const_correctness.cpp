@@ -145,3 +145,38 @@ private:
   // v--- This allows us to modify `tmp_` from inside a const method.
   mutable std::vector<double> tmp_;
 };
+
+// If a `SinusoidalV3` is shared between threads, two threads can write to
+// `tmp_` at the same time. That's a data race, even though the method is
+// `const`. The standard library promises that `const` methods are safe to call
+// concurrently; and we've broken that promise.
+//
+// The way out is to not store the scratch pad in the object. Either the caller
+// lends it explicitly, or every thread has its own copy, i.e. it's
+// `thread_local`. Then one immutable object can be shared by all threads. See
+// `ode_solvers/workspace.hpp` for the same idea applied to ODE solvers.
+
+class SinusoidalV4 {
+public:
+  SinusoidalV4(double a, double b) : a(a), b(b) {}
+
+  // The caller lends us the scratch pad. It's a non-const reference, so it's
+  // plain to see that it will be modified.
+  double operator()(double x, std::vector<double> &tmp) const {
+    tmp.resize(1);
+
+    tmp[0] = a * b;
+    return a * std::sin(tmp[0] * x) + b * std::cos(tmp[0] * x);
+  }
+
+  // For convenience, borrow the scratch pad of the calling thread. It's only
+  // allocated the first time a thread calls this method.
+  double operator()(double x) const {
+    thread_local std::vector<double> tmp(1);
+    return (*this)(x, tmp);
+  }
+
+private:
+  double a;
+  double b;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+// `std::vector<double>` only guarantees the alignment of a `double`, i.e. 8
+// bytes. A 64-byte SIMD register loaded from such a vector straddles two cache
+// lines most of the time. `AlignedVector` starts every array on a cache line
+// boundary, which is also the size of an AVX-512 register.
+//
+// Also, `resize` leaves new elements of trivial types like `double`
+// uninitialized, instead of zeroing them. Zeroing isn't free, and it decides
+// where the memory lives: on a machine with several NUMA nodes, a page is
+// placed on the node of the thread which touches it first. If the calling
+// thread zeros all of a large state, all of it ends up on one node, and
+// threads on the other nodes read it over the interconnect. See
+// `ThreadedExecution::make_vector` for touching it from the right threads.
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// Alignment in bytes of `AlignedVector`, a cache line.
+constexpr std::size_t simd_alignment = 64;
+
+/// Allocator which aligns to `Alignment` bytes.
+template <class T, std::size_t Alignment = simd_alignment>
+class AlignedAllocator {
+public:
+  static_assert(Alignment >= alignof(T) && Alignment % alignof(T) == 0,
+                "Alignment must be a multiple of the alignment of `T`.");
+
+  using value_type = T;
+
+  template <class U>
+  struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+
+  template <class U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+  T *allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+
+  void deallocate(T *ptr, std::size_t /* n */) {
+    ::operator delete(ptr, std::align_val_t(Alignment));
+  }
+
+  /// Default initialize, i.e. leave a `double` uninitialized.
+  template <class U>
+  void construct(U *ptr) {
+    ::new (static_cast<void *>(ptr)) U;
+  }
+
+  template <class U, class... Args>
+  void construct(U *ptr, Args &&...args) {
+    ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const {
+    return true;
+  }
+
+  template <class U>
+  bool operator!=(const AlignedAllocator<U, Alignment> &) const {
+    return false;
+  }
+};
+
+/// A `std::vector` whose data starts on a cache line boundary, and whose
+/// elements are default initialized by `resize`.
+template <class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/// Is `ptr` aligned to `simd_alignment` bytes?
+inline bool is_simd_aligned(const void *ptr) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % simd_alignment == 0;
+}
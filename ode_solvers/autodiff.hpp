@@ -0,0 +1,432 @@
+#pragma once
+
+// Forward-mode automatic differentiation, for exact Jacobians of a RHS.
+//
+// A dual number carries a value and the derivatives of that value in `N`
+// directions. Every operation applies the chain rule, e.g.
+//
+//   (a, da) * (b, db) = (a * b, a * db + da * b).
+//
+// Seeding the input `y_j` with the unit tangent `e_j` makes the tangent of
+// the output `f_i` equal to `df_i/dy_j`, exact up to rounding. With `N`
+// directions, a single evaluation computes `N` columns of the Jacobian; its
+// cost is roughly `N + 1` evaluations in `double`, but as a single pass with
+// loops of length `N`.
+//
+// Most Jacobians of a method of lines are sparse: `f_i` only depends on a few
+// neighbours of `y_i`. Columns which don't share a row, i.e. structurally
+// orthogonal columns, may share a direction; the tangent of `f_i` is then
+// the sum of the entries in those columns, of which at most one is nonzero.
+// Grouping the columns like that is a graph coloring. A tridiagonal Jacobian
+// needs three colors no matter its size, i.e. one sweep with `Dual<3>`
+// instead of `n + 1` evaluations for finite differences.
+//
+// The RHS must be written once, generically in the scalar, see
+// `AutoDiffRHS`. It calls the math functions unqualified, e.g.
+//
+//   using std::exp;
+//   dydt[i] = exp(y[i]);
+//
+// so that they're found by ADL for `Dual`, and in `std` for `double`.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "dense_matrix.hpp"
+#include "rhs.hpp"
+#include "span.hpp"
+
+/// A value and its derivatives in `N` directions.
+template <std::size_t N>
+class Dual {
+public:
+  /// A constant, i.e. all derivatives are zero.
+  constexpr Dual(double value = 0.0) : value(value), tangent{} {}
+
+  constexpr Dual(double value, const std::array<double, N> &tangent)
+      : value(value), tangent(tangent) {}
+
+  double value;
+  std::array<double, N> tangent;
+
+  friend Dual operator+(const Dual &a) { return a; }
+
+  friend Dual operator-(const Dual &a) {
+    auto c = Dual(-a.value);
+    for (std::size_t k = 0; k < N; ++k) {
+      c.tangent[k] = -a.tangent[k];
+    }
+    return c;
+  }
+
+  friend Dual operator+(const Dual &a, const Dual &b) {
+    auto c = Dual(a.value + b.value);
+    for (std::size_t k = 0; k < N; ++k) {
+      c.tangent[k] = a.tangent[k] + b.tangent[k];
+    }
+    return c;
+  }
+
+  friend Dual operator-(const Dual &a, const Dual &b) {
+    auto c = Dual(a.value - b.value);
+    for (std::size_t k = 0; k < N; ++k) {
+      c.tangent[k] = a.tangent[k] - b.tangent[k];
+    }
+    return c;
+  }
+
+  friend Dual operator*(const Dual &a, const Dual &b) {
+    auto c = Dual(a.value * b.value);
+    for (std::size_t k = 0; k < N; ++k) {
+      c.tangent[k] = a.value * b.tangent[k] + a.tangent[k] * b.value;
+    }
+    return c;
+  }
+
+  friend Dual operator/(const Dual &a, const Dual &b) {
+    double inv_b = 1.0 / b.value;
+    double c_value = a.value * inv_b;
+    auto c = Dual(c_value);
+    for (std::size_t k = 0; k < N; ++k) {
+      c.tangent[k] = (a.tangent[k] - c_value * b.tangent[k]) * inv_b;
+    }
+    return c;
+  }
+
+  // Mixed with `double`: converting the `double` to `Dual` would do the same,
+  // but `0.0 * x` can't be optimized away, hence twice the work.
+  friend Dual operator+(const Dual &a, double b) {
+    return Dual(a.value + b, a.tangent);
+  }
+
+  friend Dual operator+(double a, const Dual &b) { return b + a; }
+
+  friend Dual operator-(const Dual &a, double b) {
+    return Dual(a.value - b, a.tangent);
+  }
+
+  friend Dual operator-(double a, const Dual &b) { return -b + a; }
+
+  friend Dual operator*(const Dual &a, double b) {
+    auto c = Dual(a.value * b);
+    for (std::size_t k = 0; k < N; ++k) {
+      c.tangent[k] = a.tangent[k] * b;
+    }
+    return c;
+  }
+
+  friend Dual operator*(double a, const Dual &b) { return b * a; }
+
+  friend Dual operator/(const Dual &a, double b) { return a * (1.0 / b); }
+
+  friend Dual operator/(double a, const Dual &b) { return Dual(a) / b; }
+
+  Dual &operator+=(const Dual &b) { return *this = *this + b; }
+  Dual &operator-=(const Dual &b) { return *this = *this - b; }
+  Dual &operator*=(const Dual &b) { return *this = *this * b; }
+  Dual &operator/=(const Dual &b) { return *this = *this / b; }
+
+  Dual &operator+=(double b) { return *this = *this + b; }
+  Dual &operator-=(double b) { return *this = *this - b; }
+  Dual &operator*=(double b) { return *this = *this * b; }
+  Dual &operator/=(double b) { return *this = *this / b; }
+
+  // Comparisons only look at the value; branches are piecewise
+  // differentiable.
+  friend bool operator==(const Dual &a, const Dual &b) {
+    return a.value == b.value;
+  }
+  friend bool operator!=(const Dual &a, const Dual &b) {
+    return a.value != b.value;
+  }
+  friend bool operator<(const Dual &a, const Dual &b) {
+    return a.value < b.value;
+  }
+  friend bool operator<=(const Dual &a, const Dual &b) {
+    return a.value <= b.value;
+  }
+  friend bool operator>(const Dual &a, const Dual &b) {
+    return a.value > b.value;
+  }
+  friend bool operator>=(const Dual &a, const Dual &b) {
+    return a.value >= b.value;
+  }
+};
+
+/// `f(a)` with the derivative `df` at `a.value`, by the chain rule.
+template <std::size_t N>
+Dual<N> chain_rule(const Dual<N> &a, double f, double df) {
+  auto c = Dual<N>(f);
+  for (std::size_t k = 0; k < N; ++k) {
+    c.tangent[k] = df * a.tangent[k];
+  }
+  return c;
+}
+
+template <std::size_t N>
+Dual<N> abs(const Dual<N> &a) {
+  return a.value < 0.0 ? -a : a;
+}
+
+template <std::size_t N>
+Dual<N> sqrt(const Dual<N> &a) {
+  double f = std::sqrt(a.value);
+  return chain_rule(a, f, 0.5 / f);
+}
+
+template <std::size_t N>
+Dual<N> exp(const Dual<N> &a) {
+  double f = std::exp(a.value);
+  return chain_rule(a, f, f);
+}
+
+template <std::size_t N>
+Dual<N> log(const Dual<N> &a) {
+  return chain_rule(a, std::log(a.value), 1.0 / a.value);
+}
+
+template <std::size_t N>
+Dual<N> sin(const Dual<N> &a) {
+  return chain_rule(a, std::sin(a.value), std::cos(a.value));
+}
+
+template <std::size_t N>
+Dual<N> cos(const Dual<N> &a) {
+  return chain_rule(a, std::cos(a.value), -std::sin(a.value));
+}
+
+template <std::size_t N>
+Dual<N> tanh(const Dual<N> &a) {
+  double f = std::tanh(a.value);
+  return chain_rule(a, f, 1.0 - f * f);
+}
+
+template <std::size_t N>
+Dual<N> pow(const Dual<N> &a, double p) {
+  double f = std::pow(a.value, p - 1.0);
+  return chain_rule(a, f * a.value, p * f);
+}
+
+/// `std::numeric_limits` of the value; the tangent of every limit is zero.
+template <std::size_t N>
+struct std::numeric_limits<Dual<N>> : public std::numeric_limits<double> {
+private:
+  using Base = std::numeric_limits<double>;
+
+public:
+  static constexpr Dual<N> min() noexcept { return Base::min(); }
+  static constexpr Dual<N> max() noexcept { return Base::max(); }
+  static constexpr Dual<N> lowest() noexcept { return Base::lowest(); }
+  static constexpr Dual<N> epsilon() noexcept { return Base::epsilon(); }
+  static constexpr Dual<N> round_error() noexcept {
+    return Base::round_error();
+  }
+  static constexpr Dual<N> infinity() noexcept { return Base::infinity(); }
+  static constexpr Dual<N> quiet_NaN() noexcept { return Base::quiet_NaN(); }
+  static constexpr Dual<N> signaling_NaN() noexcept {
+    return Base::signaling_NaN();
+  }
+  static constexpr Dual<N> denorm_min() noexcept {
+    return Base::denorm_min();
+  }
+};
+
+/// How to get the value and derivatives out of a scalar, e.g. a `double` has
+/// no derivatives.
+template <class T, class = void>
+struct autodiff_traits;
+
+template <class T>
+struct autodiff_traits<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static constexpr std::size_t n_directions = 0;
+
+  static double value(T x) { return double(x); }
+};
+
+template <std::size_t N>
+struct autodiff_traits<Dual<N>> {
+  static constexpr std::size_t n_directions = N;
+
+  static double value(const Dual<N> &x) { return x.value; }
+  static double derivative(const Dual<N> &x, std::size_t k) {
+    return x.tangent[k];
+  }
+};
+
+/// The value of `x` without derivatives, for `double` and `Dual` alike.
+template <class T>
+double value_of(const T &x) {
+  return autodiff_traits<T>::value(x);
+}
+
+/// The sparsity pattern of a Jacobian, as the columns of the nonzero
+/// entries in each row.
+using SparsityPattern = std::vector<std::vector<std::size_t>>;
+
+/// The sparsity pattern of a periodic band matrix of size `n`, i.e. `f_i`
+/// depends on `y_{i - lower}, ..., y_{i + upper}`, modulo `n`.
+inline SparsityPattern periodic_band_sparsity(std::size_t n,
+                                              std::size_t lower,
+                                              std::size_t upper) {
+  auto sparsity = SparsityPattern(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t d = 0; d < lower + upper + 1; ++d) {
+      std::size_t j = (i + n - lower % n + d) % n;
+      if (std::find(sparsity[i].begin(), sparsity[i].end(), j)
+          == sparsity[i].end()) {
+        sparsity[i].push_back(j);
+      }
+    }
+  }
+  return sparsity;
+}
+
+/// Group the columns of `sparsity` such that no two columns of the same
+/// group have a nonzero in the same row; returns the group of each column.
+///
+/// Greedy, in the order of the columns. Optimal coloring is NP-hard, greedy
+/// needs at most one more color than the largest number of nonzeros that a
+/// column shares rows with.
+inline std::vector<std::size_t> color_columns(const SparsityPattern &sparsity) {
+  std::size_t n = sparsity.size();
+  auto rows_of = std::vector<std::vector<std::size_t>>(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j : sparsity[i]) {
+      if (j >= n) {
+        throw std::invalid_argument("color_columns: column out of range.");
+      }
+      rows_of[j].push_back(i);
+    }
+  }
+
+  auto no_color = std::numeric_limits<std::size_t>::max();
+  auto colors = std::vector<std::size_t>(n, no_color);
+  // `used_by[c] == j` means color `c` is taken by a neighbour of column `j`.
+  auto used_by = std::vector<std::size_t>();
+  for (std::size_t j = 0; j < n; ++j) {
+    for (std::size_t i : rows_of[j]) {
+      for (std::size_t neighbour : sparsity[i]) {
+        std::size_t c = colors[neighbour];
+        if (c != no_color) {
+          used_by[c] = j;
+        }
+      }
+    }
+
+    std::size_t c = 0;
+    while (c < used_by.size() && used_by[c] == j) {
+      c += 1;
+    }
+    if (c == used_by.size()) {
+      used_by.push_back(no_color);
+    }
+    colors[j] = c;
+  }
+
+  return colors;
+}
+
+/// An `RHS` which computes its Jacobian by forward-mode AD.
+///
+/// `F` is a functor with a templated call operator:
+///
+///   template <class Scalar>
+///   void operator()(Span<Scalar> dydt, Span<const Scalar> y, double t) const;
+///
+/// It's evaluated with `Scalar = double` for the rate of change and with
+/// `Scalar = Dual<N>` for the Jacobian. Without a sparsity pattern every
+/// column is a direction of its own, i.e. `ceil(n / N)` sweeps; with one,
+/// the columns are colored and it's `ceil(n_colors / N)` sweeps.
+template <class F, std::size_t N = 8>
+class AutoDiffRHS : public RHS {
+public:
+  explicit AutoDiffRHS(F f) : f(std::move(f)) {}
+
+  AutoDiffRHS(F f, SparsityPattern sparsity)
+      : f(std::move(f)),
+        sparsity(std::move(sparsity)),
+        colors(color_columns(this->sparsity)) {
+    n_colors = 0;
+    for (std::size_t c : colors) {
+      n_colors = std::max(n_colors, c + 1);
+    }
+  }
+
+  /// How many evaluations in `Dual<N>` one Jacobian costs for `n` unknowns.
+  std::size_t n_sweeps(std::size_t n) const {
+    std::size_t n_directions = colors.empty() ? n : n_colors;
+    return (n_directions + N - 1) / N;
+  }
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    f(dydt, y, t);
+  }
+
+  bool do_jacobian(DenseMatrix &dfdy,
+                   Span<const double> y,
+                   double t) const override {
+    std::size_t n = y.size();
+    if (!colors.empty() && colors.size() != n) {
+      throw std::invalid_argument("AutoDiffRHS: wrong size of the sparsity.");
+    }
+
+    dfdy.resize(n);
+    dfdy.set_zero();
+
+    // Once per thread, not per call; `jacobian` has no workspace.
+    thread_local std::vector<Dual<N>> y_dual, dydt_dual;
+    y_dual.resize(n);
+    dydt_dual.resize(n);
+
+    std::size_t n_directions = colors.empty() ? n : n_colors;
+    for (std::size_t first = 0; first < n_directions; first += N) {
+      // Direction `k` of this sweep is the color `first + k`.
+      for (std::size_t j = 0; j < n; ++j) {
+        std::size_t c = colors.empty() ? j : colors[j];
+        y_dual[j] = Dual<N>(y[j]);
+        if (first <= c && c < first + N) {
+          y_dual[j].tangent[c - first] = 1.0;
+        }
+      }
+
+      f(Span<Dual<N>>(dydt_dual), Span<const Dual<N>>(y_dual), t);
+
+      if (colors.empty()) {
+        std::size_t n_columns = std::min(N, n - first);
+        for (std::size_t i = 0; i < n; ++i) {
+          for (std::size_t k = 0; k < n_columns; ++k) {
+            dfdy(i, first + k) = dydt_dual[i].tangent[k];
+          }
+        }
+      } else {
+        for (std::size_t i = 0; i < n; ++i) {
+          for (std::size_t j : sparsity[i]) {
+            std::size_t c = colors[j];
+            if (first <= c && c < first + N) {
+              dfdy(i, j) = dydt_dual[i].tangent[c - first];
+            }
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+private:
+  F f;
+  SparsityPattern sparsity;
+  std::vector<std::size_t> colors;
+  std::size_t n_colors = 0;
+};
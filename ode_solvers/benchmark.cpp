@@ -0,0 +1,697 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make benchmark
+//
+// Run as
+//     ./benchmark [MAX_N_VARS] > results.json
+//
+// Topic: Throughput of the ODE stepping path.
+//
+// Sweeps the number of unknowns from 3, as in `ic()`, to `MAX_N_VARS`
+// (default 10^8, which needs several GB of RAM for the multistage schemes).
+// For each size it times `solve_ode` for every scheme; virtual vs. static
+// dispatch; serial vs. multithreaded execution; and, for the low-storage
+// scheme, double vs. single vs. mixed precision. The RHS is `ExpRHS`
+// throughout. The accuracy of the precisions is compared in
+// `usecase_mixed_precision`.
+//
+// The results are written to stdout as JSON, one record per run, such that
+// two versions can be diffed. Progress is reported on stderr. The metrics are:
+//
+//   steps_per_second
+//   rhs_evals_per_second
+//   effective_gb_per_second   the compulsory traffic of a step divided by the
+//                             time: every pass the scheme makes over a vector
+//                             or matrix, each read or written once. Modelled
+//                             per scheme, see `*_passes` below; `null` if the
+//                             traffic isn't known.
+//   ns_per_unknown_per_step
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "butcher_tableau.hpp"
+#include "counting_rhs.hpp"
+#include "dormand_prince.hpp"
+#include "exponential.hpp"
+#include "imex.hpp"
+#include "implicit.hpp"
+#include "jfnk.hpp"
+#include "low_storage_rk.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "static_dispatch.hpp"
+#include "threaded.hpp"
+
+struct Measurement {
+  double seconds;
+  std::size_t n_rhs_evals;
+
+  // The compulsory memory traffic of all steps.
+  std::optional<double> bytes = std::nullopt;
+};
+
+// One line of the table: a way of running `n_steps` steps on `n_vars`
+// unknowns.
+struct BenchmarkCase {
+  std::string scheme;
+  std::string dispatch;
+  std::string execution;
+
+  // Larger systems are skipped, e.g. because of a dense Jacobian.
+  std::size_t max_n_vars;
+
+  // The cost of a step grows like `n_vars^cost_exponent`.
+  int cost_exponent;
+
+  std::function<Measurement(std::size_t n_vars, std::size_t n_steps)> run;
+
+  // Of the state; "mixed" is a `float` state with `double` accumulation.
+  std::string precision = "double";
+};
+
+// A power of two, such that `t += dt` is exact and `solve_ode` takes exactly
+// `T / dt` steps. With at most `2^20` steps, the longest run ends at `t = 1`;
+// much later and the solution decays to subnormal numbers, which are much
+// slower.
+constexpr double dt = 1.0 / (1 << 20);
+
+// The traffic models count passes over the state, i.e. `n_vars` scalars. A
+// RHS evaluation is two: read `y`, write `f`. The fused update `add_scaled`
+// of `ExpRHS` is three, or two if `base` and `y` are the same.
+
+// One step of `ExplicitRKStep<Tableau>`, see `butcher_tableau.hpp`: a stage
+// reads `y0` and the stages it depends on, writes the intermediate state, and
+// the RHS reads that and writes the stage. A stage without dependencies reads
+// `y0` directly.
+template <class Tableau>
+constexpr double explicit_rk_passes() {
+  double passes = 0.0;
+  for (std::size_t s = 0; s < Tableau::n_stages; ++s) {
+    double n_deps = 0.0;
+    for (std::size_t j = 0; j < s; ++j) {
+      n_deps += Tableau::a[s][j] != 0.0 ? 1.0 : 0.0;
+    }
+    passes += n_deps == 0.0 ? 2.0 : n_deps + 4.0;
+  }
+
+  for (std::size_t j = 0; j < Tableau::n_stages; ++j) {
+    passes += Tableau::b[j] != 0.0 ? 1.0 : 0.0;
+  }
+  return passes + 2.0;
+}
+
+// One step of a `BasicLowStorageRKStep` with a fused RHS: the first stage is
+// the RHS and the update, `y` and `dq` read and written; the others three
+// more for `dq = A dq + dt f`.
+double low_storage_passes(std::size_t n_stages) {
+  return 6.0 + 7.0 * double(n_stages - 1);
+}
+
+// Same as above, in bytes per unknown for a `float` state and a `double`
+// `dq`. Each step first zeroes `dq`; then a stage is `add_scaled_widened`
+// and the update.
+double mixed_low_storage_bytes(std::size_t n_stages) {
+  double stage = (sizeof(float) + 2 * sizeof(double))
+                 + 2 * (sizeof(float) + sizeof(double));
+  return sizeof(double) + stage * double(n_stages);
+}
+
+// One step of `DormandPrinceStep::advance`, see `dormand_prince.hpp`: the
+// first stage; six stages reading `y0` and `1, ..., 6` previous stages; and
+// the error estimate from seven stages.
+constexpr double dormand_prince_passes = 2.0 + (5.0 + 6.0 + 7.0 + 8.0 + 9.0)
+                                         + 9.0 + 7.0;
+
+// One step of an exponential integrator, see `exponential.hpp`: the linear
+// part is written and compared to the cached one, three; then for
+// Exponential Euler the RHS and the update, reading `y0`, `f0` and
+// `dt phi_1`. ETDRK2 adds a RHS and the correction, which reads six vectors.
+constexpr double exponential_euler_passes = 3.0 + 2.0 + 4.0;
+constexpr double etdrk2_passes = exponential_euler_passes + 2.0 + 7.0;
+
+// The Newton iterations of `n_solves` solves, see `NewtonSolver`. An
+// iteration is the RHS, the residual, the solve with the LU factors, i.e.
+// `n_vars` passes plus the pivots and the vector, and the update. A Jacobian
+// writes the dense matrix, a factorization reads and writes two. Every solve
+// saves the initial guess.
+double newton_passes(const NewtonStats &stats,
+                     std::size_t n_solves,
+                     std::size_t n_vars) {
+  double n = double(n_vars);
+  return double(stats.n_iterations) * (n + 16.0)
+         + double(stats.n_jacobians) * n
+         + double(stats.n_factorizations) * 4.0 * n + 2.0 * double(n_solves);
+}
+
+// Outside of Newton: Backward Euler copies `y0` into `y1`; BDF2 also
+// compares `y0` to its history, combines two states into the right hand side
+// and saves `y1`.
+constexpr double backward_euler_passes = 2.0;
+constexpr double bdf2_passes = 2.0 + 3.0 + 2.0 + 2.0;
+
+// Does a later stage, or the update, use stage `s`; see `IMEXARKStep`.
+template <std::size_t n_stages>
+constexpr bool is_stage_used(const double (&a)[n_stages][n_stages],
+                             const double (&b)[n_stages],
+                             std::size_t s) {
+  for (std::size_t r = s + 1; r < n_stages; ++r) {
+    if (a[r][s] != 0.0) {
+      return true;
+    }
+  }
+  return b[s] != 0.0;
+}
+
+// One step of `IMEXARKStep<Tableau>` outside of Newton, see `imex.hpp`: per
+// stage the right hand side from `y0` and the nonzero weights, its copy, and
+// the RHS which are used; then the update.
+template <class Tableau>
+constexpr double imex_passes() {
+  constexpr std::size_t n_stages = Tableau::n_stages;
+  double passes = 0.0;
+  for (std::size_t s = 0; s < n_stages; ++s) {
+    passes += 4.0;
+    for (std::size_t j = 0; j < s; ++j) {
+      passes += Tableau::a_explicit[s][j] != 0.0 ? 3.0 : 0.0;
+      passes += Tableau::a_implicit[s][j] != 0.0 ? 3.0 : 0.0;
+    }
+    if (is_stage_used(Tableau::a_explicit, Tableau::b_explicit, s)) {
+      passes += 2.0;
+    }
+    if (is_stage_used(Tableau::a_implicit, Tableau::b_implicit, s)) {
+      passes += 2.0;
+    }
+  }
+
+  passes += 2.0;
+  for (std::size_t j = 0; j < n_stages; ++j) {
+    passes += Tableau::b_explicit[j] != 0.0 ? 3.0 : 0.0;
+    passes += Tableau::b_implicit[j] != 0.0 ? 3.0 : 0.0;
+  }
+  return passes;
+}
+
+// The stages of `IMEXARKStep<Tableau>` which need Newton.
+template <class Tableau>
+constexpr std::size_t imex_newton_solves() {
+  std::size_t n_solves = 0;
+  for (std::size_t s = 0; s < Tableau::n_stages; ++s) {
+    n_solves += Tableau::a_implicit[s][s] != 0.0 ? 1 : 0;
+  }
+  return n_solves;
+}
+
+// `passes` passes over `n_vars` doubles in each of `n_steps` steps.
+double bytes(double passes, std::size_t n_vars, std::size_t n_steps) {
+  return passes * double(n_vars) * double(n_steps) * sizeof(double);
+}
+
+template <class F>
+double time_seconds(const F &f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+// Time `n_steps` steps of `rk_step` with the in-place `solve_ode`, after a
+// warm-up step which sizes the buffer and fills the workspace; i.e. neither
+// allocation nor first touch is timed. `before_timing` is called after the
+// warm-up.
+template <class Scalar, class F>
+double time_seconds(const BasicRKStep<Scalar> &rk_step,
+                    std::size_t n_vars,
+                    std::size_t n_steps,
+                    const F &before_timing) {
+  auto y = AlignedVector<Scalar>(n_vars, Scalar(1.0));
+  auto buffer = AlignedVector<Scalar>{};
+  auto observer = BasicNullObserver<Scalar>{};
+  auto &workspace = thread_local_workspace();
+  solve_ode(rk_step, Span<Scalar>(y), buffer, dt, dt, observer, workspace);
+
+  before_timing();
+  double T = double(n_steps) * dt;
+  return time_seconds([&]() {
+    solve_ode(rk_step, Span<Scalar>(y), buffer, T, dt, observer, workspace);
+  });
+}
+
+// Same as above, without counting RHS evaluations.
+template <class Scalar>
+double time_seconds(const BasicRKStep<Scalar> &rk_step,
+                    std::size_t n_vars,
+                    std::size_t n_steps) {
+  return time_seconds(rk_step, n_vars, n_steps, []() {});
+}
+
+// Same as above, counting the RHS evaluations of the timed steps. Each step
+// makes `passes` passes over the state.
+Measurement time_virtual(const RKStep &rk_step,
+                         const CountingRHS &rhs,
+                         std::size_t n_vars,
+                         std::size_t n_steps,
+                         std::optional<double> passes) {
+  std::size_t n_evals_before = 0;
+  double seconds = time_seconds(
+      rk_step, n_vars, n_steps, [&]() { n_evals_before = rhs.count(); });
+
+  auto m = Measurement{seconds, rhs.count() - n_evals_before};
+  if (passes) {
+    m.bytes = bytes(*passes, n_vars, n_steps);
+  }
+  return m;
+}
+
+// Same as above, for a step with `newton_stats` which solves
+// `n_solves_per_step` nonlinear systems per step.
+template <class Step>
+Measurement time_newton(const Step &rk_step,
+                        const CountingRHS &rhs,
+                        std::size_t n_vars,
+                        std::size_t n_steps,
+                        double passes,
+                        std::size_t n_solves_per_step) {
+  auto &workspace = thread_local_workspace();
+  std::size_t n_evals_before = 0;
+  auto before = NewtonStats{};
+  double seconds = time_seconds(rk_step, n_vars, n_steps, [&]() {
+    n_evals_before = rhs.count();
+    before = rk_step.newton_stats(workspace);
+  });
+
+  auto stats = rk_step.newton_stats(workspace);
+  stats.n_iterations -= before.n_iterations;
+  stats.n_jacobians -= before.n_jacobians;
+  stats.n_factorizations -= before.n_factorizations;
+
+  double newton = newton_passes(stats, n_solves_per_step * n_steps, n_vars);
+  return {seconds,
+          rhs.count() - n_evals_before,
+          bytes(passes, n_vars, n_steps) + bytes(newton, n_vars, 1)};
+}
+
+std::vector<BenchmarkCase> make_cases(std::shared_ptr<ThreadPool> pool) {
+  auto exp_rhs = std::make_shared<ExpRHS>();
+  auto execution = ThreadedExecution(pool);
+  std::size_t any_size = std::size_t(-1);
+
+  auto cases = std::vector<BenchmarkCase>{};
+
+  cases.push_back(
+      {"forward_euler",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(
+             ForwardEulerStep(rhs), *rhs, n_vars, n_steps, 2.0);
+       }});
+
+  cases.push_back(
+      {"forward_euler",
+       "static",
+       "serial",
+       any_size,
+       1,
+       [](std::size_t n_vars, std::size_t n_steps) {
+         // In place, after a warm-up step which sizes the buffer.
+         auto step = StaticForwardEulerStep<ExpKernel>();
+         auto y = AlignedVector<double>(n_vars, 1.0);
+         auto buffer = AlignedVector<double>{};
+         solve_ode_static(step, Span<double>(y), buffer, dt, dt);
+
+         double T = double(n_steps) * dt;
+         double seconds = time_seconds([&]() {
+           solve_ode_static(step, Span<double>(y), buffer, T, dt);
+         });
+         return Measurement{seconds, n_steps, bytes(2.0, n_vars, n_steps)};
+       }});
+
+  cases.push_back({"forward_euler",
+                   "virtual",
+                   "threaded",
+                   any_size,
+                   1,
+                   [exp_rhs, execution](std::size_t n_vars,
+                                        std::size_t n_steps) {
+                     // A `CountingRHS` isn't a `RangeRHS`; it's one RHS
+                     // evaluation per step.
+                     auto rk_step
+                         = ThreadedForwardEulerStep(exp_rhs, execution);
+                     return Measurement{
+                         time_seconds(rk_step, n_vars, n_steps),
+                         n_steps,
+                         bytes(2.0, n_vars, n_steps)};
+                   }});
+
+  cases.push_back(
+      {"dormand_prince",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(DormandPrinceStep(rhs),
+                             *rhs,
+                             n_vars,
+                             n_steps,
+                             dormand_prince_passes);
+       }});
+
+  cases.push_back(
+      {"rk4",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(RK4Step(rhs),
+                             *rhs,
+                             n_vars,
+                             n_steps,
+                             explicit_rk_passes<RK4Tableau>());
+       }});
+
+  cases.push_back(
+      {"heun",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(HeunStep(rhs),
+                             *rhs,
+                             n_vars,
+                             n_steps,
+                             explicit_rk_passes<HeunTableau>());
+       }});
+
+  cases.push_back(
+      {"ssp_rk3",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(SSPRK3Step(rhs),
+                             *rhs,
+                             n_vars,
+                             n_steps,
+                             explicit_rk_passes<SSPRK3Tableau>());
+       }});
+
+  cases.push_back(
+      {"rk38",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(RK38Step(rhs),
+                             *rhs,
+                             n_vars,
+                             n_steps,
+                             explicit_rk_passes<RK38Tableau>());
+       }});
+
+  // `ExpRHS` is all linear part, `CountingRHS` forwards it.
+  cases.push_back(
+      {"exponential_euler",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(ExponentialEulerStep(rhs),
+                             *rhs,
+                             n_vars,
+                             n_steps,
+                             exponential_euler_passes);
+       }});
+
+  cases.push_back(
+      {"etdrk2",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(
+             ETDRK2Step(rhs), *rhs, n_vars, n_steps, etdrk2_passes);
+       }});
+
+  cases.push_back(
+      {"williamson_rk3",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         auto rk_step = LowStorageRKStep(rhs, williamson_rk3_tableau());
+         return time_virtual(
+             rk_step, *rhs, n_vars, n_steps, low_storage_passes(3));
+       }});
+
+  cases.push_back(
+      {"carpenter_kennedy_rk4",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         auto rk_step
+             = LowStorageRKStep(rhs, carpenter_kennedy_rk4_tableau());
+         return time_virtual(
+             rk_step, *rhs, n_vars, n_steps, low_storage_passes(5));
+       }});
+
+  cases.push_back(
+      {"carpenter_kennedy_rk4",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [](std::size_t n_vars, std::size_t n_steps) {
+         auto rk_step = BasicLowStorageRKStep<float>(
+             std::make_shared<BasicExpRHS<float>>(),
+             carpenter_kennedy_rk4_tableau());
+         double bytes_per_step
+             = low_storage_passes(5) * sizeof(float) * double(n_vars);
+         return Measurement{time_seconds(rk_step, n_vars, n_steps),
+                            5 * n_steps,
+                            bytes_per_step * double(n_steps)};
+       },
+       "float"});
+
+  cases.push_back(
+      {"carpenter_kennedy_rk4",
+       "virtual",
+       "serial",
+       any_size,
+       1,
+       [](std::size_t n_vars, std::size_t n_steps) {
+         auto rk_step = MixedPrecisionLowStorageRKStep(
+             std::make_shared<BasicExpRHS<double>>(),
+             carpenter_kennedy_rk4_tableau());
+         double bytes_per_step
+             = mixed_low_storage_bytes(5) * double(n_vars);
+         return Measurement{time_seconds(rk_step, n_vars, n_steps),
+                            5 * n_steps,
+                            bytes_per_step * double(n_steps)};
+       },
+       "mixed"});
+
+  cases.push_back(
+      {"dormand_prince",
+       "virtual",
+       "threaded",
+       any_size,
+       1,
+       [exp_rhs, execution](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(
+             std::make_shared<ThreadedRHS>(exp_rhs, execution));
+         return time_virtual(DormandPrinceStep(rhs),
+                             *rhs,
+                             n_vars,
+                             n_steps,
+                             dormand_prince_passes);
+       }});
+
+  // The Jacobian is dense, i.e. n^2 memory and work per step; and n^3 work to
+  // factorize it.
+  std::size_t max_implicit_n_vars = 1000;
+
+  cases.push_back(
+      {"backward_euler",
+       "virtual",
+       "serial",
+       max_implicit_n_vars,
+       2,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_newton(BackwardEulerStep(rhs),
+                            *rhs,
+                            n_vars,
+                            n_steps,
+                            backward_euler_passes,
+                            1);
+       }});
+
+  cases.push_back(
+      {"bdf",
+       "virtual",
+       "serial",
+       max_implicit_n_vars,
+       2,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_newton(
+             BDFStep(rhs), *rhs, n_vars, n_steps, bdf2_passes, 1);
+       }});
+
+  // `ExpRHS` as both the non-stiff and the stiff part; one `CountingRHS`
+  // counts the evaluations of both.
+  cases.push_back(
+      {"imex_euler",
+       "virtual",
+       "serial",
+       max_implicit_n_vars,
+       2,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_newton(IMEXEulerStep(SplitRHS{rhs, rhs}),
+                            *rhs,
+                            n_vars,
+                            n_steps,
+                            imex_passes<IMEXEulerTableau>(),
+                            imex_newton_solves<IMEXEulerTableau>());
+       }});
+
+  cases.push_back(
+      {"ark324",
+       "virtual",
+       "serial",
+       max_implicit_n_vars,
+       2,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_newton(ARK324Step(SplitRHS{rhs, rhs}),
+                            *rhs,
+                            n_vars,
+                            n_steps,
+                            imex_passes<ARK324Tableau>(),
+                            imex_newton_solves<ARK324Tableau>());
+       }});
+
+  // Matrix-free, i.e. linear in `n_vars`; but the Krylov basis may hold
+  // `krylov_dim + 1` vectors. The traffic of GMRES grows with the iteration
+  // within a restart cycle, which the statistics don't record; hence, no
+  // traffic model.
+  cases.push_back(
+      {"jfnk_backward_euler",
+       "virtual",
+       "serial",
+       10000000,
+       1,
+       [exp_rhs](std::size_t n_vars, std::size_t n_steps) {
+         auto rhs = std::make_shared<CountingRHS>(exp_rhs);
+         return time_virtual(
+             JFNKBackwardEulerStep(rhs), *rhs, n_vars, n_steps, std::nullopt);
+       }});
+
+  return cases;
+}
+
+std::vector<std::size_t> sweep(std::size_t max_n_vars) {
+  auto sizes = std::vector<std::size_t>{3};
+  for (std::size_t n = 10; n <= max_n_vars; n *= 10) {
+    sizes.push_back(n);
+  }
+  return sizes;
+}
+
+int main(int argc, char *argv[]) {
+  std::size_t max_n_vars = argc > 1 ? std::stoul(argv[1]) : 100000000;
+
+  // Roughly the same amount of work for every size.
+  std::size_t work = std::size_t(1) << 26;
+
+  auto pool = std::make_shared<ThreadPool>();
+  auto cases = make_cases(pool);
+
+  std::cout << "{\n"
+            << "  \"benchmark\": \"ode_solvers\",\n"
+            << "  \"format_version\": 4,\n"
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"n_threads\": " << pool->n_threads() << ",\n"
+            << "  \"runs\": [";
+
+  bool is_first = true;
+  for (auto n_vars : sweep(max_n_vars)) {
+    for (const auto &c : cases) {
+      if (n_vars > c.max_n_vars) {
+        continue;
+      }
+
+      std::size_t cost = c.cost_exponent == 1 ? n_vars : n_vars * n_vars;
+      std::size_t n_steps
+          = std::clamp(work / cost, std::size_t(4), std::size_t(1) << 20);
+
+      std::cerr << c.scheme << " " << c.precision << " " << c.dispatch << " "
+                << c.execution
+                << " n_vars = " << n_vars << "\n";
+
+      auto m = c.run(n_vars, n_steps);
+      double unknown_steps = double(n_vars) * double(n_steps);
+
+      std::cout << (is_first ? "\n" : ",\n") << "    {"
+                << "\"scheme\": \"" << c.scheme << "\", "
+                << "\"precision\": \"" << c.precision << "\", "
+                << "\"dispatch\": \"" << c.dispatch << "\", "
+                << "\"execution\": \"" << c.execution << "\", "
+                << "\"n_vars\": " << n_vars << ", "
+                << "\"n_steps\": " << n_steps << ", "
+                << "\"seconds\": " << m.seconds << ", "
+                << "\"steps_per_second\": " << double(n_steps) / m.seconds
+                << ", "
+                << "\"rhs_evals_per_second\": "
+                << double(m.n_rhs_evals) / m.seconds << ", "
+                << "\"effective_gb_per_second\": ";
+      if (m.bytes) {
+        std::cout << *m.bytes / m.seconds * 1e-9;
+      } else {
+        std::cout << "null";
+      }
+      std::cout << ", "
+                << "\"ns_per_unknown_per_step\": "
+                << m.seconds / unknown_steps * 1e9 << "}";
+
+      is_first = false;
+    }
+  }
+
+  std::cout << "\n  ]\n}\n";
+
+  return 0;
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+// One explicit RK step for all explicit schemes. The scheme is a class with
+// the Butcher tableau as `static constexpr` members:
+//
+//   struct MyTableau {
+//     static constexpr std::size_t n_stages = S;
+//     static constexpr int order = p;
+//     static constexpr double a[S][S] = {...};
+//     static constexpr double b[S] = {...};
+//     static constexpr double c[S] = {...};
+//   };
+//
+// Since the tableau is known at compile time, the loops over stages are
+// unrolled and every zero coefficient is dropped before the compiler sees the
+// loops over the state. E.g. for RK4 the second stage is
+//
+//   y_stage[i] = y0[i] + (dt * a[1][0]) * k[0][i];
+//
+// i.e. the same code one would write by hand.
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// Forward Euler.
+struct EulerTableau {
+  static constexpr std::size_t n_stages = 1;
+  static constexpr int order = 1;
+  static constexpr double a[1][1] = {{0.0}};
+  static constexpr double b[1] = {1.0};
+  static constexpr double c[1] = {0.0};
+};
+
+/// Heun's method, i.e. the explicit trapezoidal rule.
+struct HeunTableau {
+  static constexpr std::size_t n_stages = 2;
+  static constexpr int order = 2;
+  static constexpr double a[2][2] = {{0.0, 0.0}, {1.0, 0.0}};
+  static constexpr double b[2] = {0.5, 0.5};
+  static constexpr double c[2] = {0.0, 1.0};
+};
+
+/// The third order strong stability preserving scheme of Shu and Osher.
+struct SSPRK3Tableau {
+  static constexpr std::size_t n_stages = 3;
+  static constexpr int order = 3;
+  static constexpr double a[3][3]
+      = {{0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {0.25, 0.25, 0.0}};
+  static constexpr double b[3] = {1.0 / 6.0, 1.0 / 6.0, 2.0 / 3.0};
+  static constexpr double c[3] = {0.0, 1.0, 0.5};
+};
+
+/// The classic fourth order Runge-Kutta scheme.
+struct RK4Tableau {
+  static constexpr std::size_t n_stages = 4;
+  static constexpr int order = 4;
+  static constexpr double a[4][4] = {{0.0, 0.0, 0.0, 0.0},
+                                     {0.5, 0.0, 0.0, 0.0},
+                                     {0.0, 0.5, 0.0, 0.0},
+                                     {0.0, 0.0, 1.0, 0.0}};
+  static constexpr double b[4] = {1.0 / 6.0, 1.0 / 3.0, 1.0 / 3.0, 1.0 / 6.0};
+  static constexpr double c[4] = {0.0, 0.5, 0.5, 1.0};
+};
+
+/// Kutta's 3/8-rule, fourth order.
+struct RK38Tableau {
+  static constexpr std::size_t n_stages = 4;
+  static constexpr int order = 4;
+  static constexpr double a[4][4] = {{0.0, 0.0, 0.0, 0.0},
+                                     {1.0 / 3.0, 0.0, 0.0, 0.0},
+                                     {-1.0 / 3.0, 1.0, 0.0, 0.0},
+                                     {1.0, -1.0, 1.0, 0.0}};
+  static constexpr double b[4] = {1.0 / 8.0, 3.0 / 8.0, 3.0 / 8.0, 1.0 / 8.0};
+  static constexpr double c[4] = {0.0, 1.0 / 3.0, 2.0 / 3.0, 1.0};
+};
+
+/// Is `Tableau` explicit and consistent, i.e. `a` strictly lower triangular,
+/// `sum(b) == 1` and `c[s] == sum(a[s])` up to rounding?
+template <class Tableau>
+constexpr bool is_explicit_tableau() {
+  constexpr std::size_t S = Tableau::n_stages;
+  auto is_close = [](double x, double y) {
+    double d = x - y;
+    return -1e-14 <= d && d <= 1e-14;
+  };
+
+  double sum_b = 0.0;
+  for (std::size_t s = 0; s < S; ++s) {
+    double sum_a = 0.0;
+    for (std::size_t j = 0; j < S; ++j) {
+      if (j >= s && Tableau::a[s][j] != 0.0) {
+        return false;
+      }
+      sum_a += Tableau::a[s][j];
+    }
+
+    if (!is_close(sum_a, Tableau::c[s])) {
+      return false;
+    }
+    sum_b += Tableau::b[s];
+  }
+
+  return is_close(sum_b, 1.0);
+}
+
+/// The explicit RK step with the Butcher tableau `Tableau`.
+///
+/// Uses the slots `0, ..., n_stages` of the workspace for the stages and the
+/// intermediate state.
+template <class Tableau, class Scalar = double>
+class ExplicitRKStep : public BasicRKStep<Scalar> {
+private:
+  static constexpr std::size_t n_stages = Tableau::n_stages;
+  static_assert(is_explicit_tableau<Tableau>(),
+                "Tableau isn't explicit, or isn't consistent.");
+
+  using Stages = std::array<Span<Scalar>, n_stages>;
+  using StagePointers = std::array<const Scalar *, n_stages>;
+
+public:
+  explicit ExplicitRKStep(std::shared_ptr<BasicRHS<Scalar>> rhs)
+      : rhs(std::move(rhs)) {}
+
+  static constexpr int order() { return Tableau::order; }
+
+protected:
+  void do_advance(Span<Scalar> y1,
+                  Span<const Scalar> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+    std::size_t n = y0.size();
+
+    // A single stage without a scratch pad, see `ForwardEulerStep`.
+    if constexpr (n_stages == 1) {
+      if (rhs->add_scaled(y1, y0, dt * Tableau::b[0], y0, t)) {
+        return;
+      }
+    }
+
+    auto k = Stages{};
+    auto k_ptr = StagePointers{};
+    for (std::size_t s = 0; s < n_stages; ++s) {
+      k[s] = workspace.vector<Scalar>(s, n);
+      k_ptr[s] = k[s].data();
+    }
+    auto &y_stage = workspace.vector<Scalar>(n_stages, n);
+
+    compute_stages(
+        k, k_ptr, y_stage, y0, t, dt, std::make_index_sequence<n_stages>{});
+
+    const Scalar *y0_ptr = y0.data();
+    Scalar *y1_ptr = y1.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      Scalar y1_i = y0_ptr[i];
+      add_weighted<n_stages>(
+          y1_i, k_ptr, i, dt, std::make_index_sequence<n_stages>{});
+      y1_ptr[i] = y1_i;
+    }
+  }
+
+private:
+  template <std::size_t... s>
+  void compute_stages(const Stages &k,
+                      const StagePointers &k_ptr,
+                      Span<Scalar> y_stage,
+                      Span<const Scalar> y0,
+                      double t,
+                      double dt,
+                      std::index_sequence<s...>) const {
+    (compute_stage<s>(k, k_ptr, y_stage, y0, t, dt), ...);
+  }
+
+  // `k[s] = f(y0 + dt * sum_j a[s][j] * k[j], t + c[s] * dt)`
+  template <std::size_t s>
+  void compute_stage(const Stages &k,
+                     const StagePointers &k_ptr,
+                     Span<Scalar> y_stage,
+                     Span<const Scalar> y0,
+                     double t,
+                     double dt) const {
+    double t_stage = t + Tableau::c[s] * dt;
+
+    // E.g. the first stage, the RHS at `y0` itself.
+    if constexpr (is_zero_row<s>()) {
+      (*rhs)(k[s], y0, t_stage);
+    } else {
+      const Scalar *y0_ptr = y0.data();
+      Scalar *y_stage_ptr = y_stage.data();
+      for (std::size_t i = 0; i < y0.size(); ++i) {
+        Scalar y_i = y0_ptr[i];
+        add_weighted<s>(y_i, k_ptr, i, dt, std::make_index_sequence<s>{});
+        y_stage_ptr[i] = y_i;
+      }
+
+      (*rhs)(k[s], y_stage, t_stage);
+    }
+  }
+
+  // The weights of stage `s`, i.e. `a[s]`; or `b` if `s == n_stages`.
+  template <std::size_t s, std::size_t j>
+  static constexpr double weight() {
+    if constexpr (s == n_stages) {
+      return Tableau::b[j];
+    } else {
+      return Tableau::a[s][j];
+    }
+  }
+
+  // `y_i += sum_j (dt * weight<s, j>()) * k[j][i]`, without the zero weights.
+  template <std::size_t s, std::size_t... j>
+  static void add_weighted(Scalar &y_i,
+                           const StagePointers &k_ptr,
+                           std::size_t i,
+                           double dt,
+                           std::index_sequence<j...>) {
+    (add_weighted<s, j>(y_i, k_ptr, i, dt), ...);
+  }
+
+  template <std::size_t s, std::size_t j>
+  static void add_weighted(Scalar &y_i,
+                           const StagePointers &k_ptr,
+                           std::size_t i,
+                           double dt) {
+    if constexpr (weight<s, j>() != 0.0) {
+      y_i += Scalar(dt * weight<s, j>()) * k_ptr[j][i];
+    }
+  }
+
+  template <std::size_t s>
+  static constexpr bool is_zero_row() {
+    for (std::size_t j = 0; j < s; ++j) {
+      if (Tableau::a[s][j] != 0.0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::shared_ptr<BasicRHS<Scalar>> rhs;
+};
+
+using HeunStep = ExplicitRKStep<HeunTableau>;
+using SSPRK3Step = ExplicitRKStep<SSPRK3Tableau>;
+using RK4Step = ExplicitRKStep<RK4Tableau>;
+using RK38Step = ExplicitRKStep<RK38Tableau>;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "dense_matrix.hpp"
+#include "rhs.hpp"
+#include "span.hpp"
+
+/// A decorator which counts how often the RHS is evaluated.
+///
+/// A fused update counts as an evaluation, a batch as one per state. Computing
+/// the Jacobian doesn't.
+class CountingRHS : public RHS {
+public:
+  explicit CountingRHS(std::shared_ptr<RHS> rhs) : rhs(std::move(rhs)) {}
+
+  std::size_t count() const { return n_evals; }
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    n_evals += 1;
+    (*rhs)(dydt, y, t);
+  }
+
+  void do_eval_batch(Span<double> dydt,
+                     Span<const double> y,
+                     double t,
+                     std::size_t n_states,
+                     BatchLayout layout) const override {
+    n_evals += n_states;
+    rhs->eval_batch(dydt, y, t, n_states, layout);
+  }
+
+  bool do_add_scaled(Span<double> out,
+                     Span<const double> base,
+                     double alpha,
+                     Span<const double> y,
+                     double t) const override {
+    bool is_fused = rhs->add_scaled(out, base, alpha, y, t);
+    if (is_fused) {
+      n_evals += 1;
+    }
+    return is_fused;
+  }
+
+  bool do_add_scaled_widened(Span<double> out,
+                             Span<const double> base,
+                             double alpha,
+                             Span<const float> y,
+                             double t) const override {
+    bool is_fused = rhs->add_scaled_widened(out, base, alpha, y, t);
+    if (is_fused) {
+      n_evals += 1;
+    }
+    return is_fused;
+  }
+
+  bool do_jacobian(DenseMatrix &dfdy,
+                   Span<const double> y,
+                   double t) const override {
+    return rhs->jacobian(dfdy, y, t);
+  }
+
+  bool do_linear_part(Span<double> lambda, double t) const override {
+    return rhs->linear_part(lambda, t);
+  }
+
+private:
+  std::shared_ptr<RHS> rhs;
+  mutable std::atomic<std::size_t> n_evals = 0;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+// Just enough dense linear algebra for the Newton iterations of implicit
+// steps on small to moderately sized systems.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "span.hpp"
+
+/// A square matrix stored row-major.
+class DenseMatrix {
+public:
+  DenseMatrix() = default;
+  explicit DenseMatrix(std::size_t n) : n(n), data(n * n) {}
+
+  std::size_t size() const { return n; }
+
+  /// Resize to `n x n`, the entries are unspecified afterwards.
+  void resize(std::size_t n_new) {
+    n = n_new;
+    data.resize(n * n);
+  }
+
+  void set_zero() { std::fill(data.begin(), data.end(), 0.0); }
+
+  double &operator()(std::size_t i, std::size_t j) { return data[i * n + j]; }
+  double operator()(std::size_t i, std::size_t j) const {
+    return data[i * n + j];
+  }
+
+private:
+  std::size_t n = 0;
+  std::vector<double> data;
+};
+
+/// LU factorization with partial pivoting, i.e. `P A = L U`.
+///
+/// Factorizing costs O(n^3), solving O(n^2). Hence, it pays to factorize once
+/// and solve many times.
+class LUFactorization {
+public:
+  /// Factorize `a`; throws `std::runtime_error` if `a` is singular.
+  void factorize(const DenseMatrix &a) {
+    std::size_t n = a.size();
+    lu = a;
+    pivots.resize(n);
+
+    for (std::size_t k = 0; k < n; ++k) {
+      std::size_t p = k;
+      for (std::size_t i = k + 1; i < n; ++i) {
+        if (std::abs(lu(i, k)) > std::abs(lu(p, k))) {
+          p = i;
+        }
+      }
+
+      if (lu(p, k) == 0.0) {
+        throw std::runtime_error("LUFactorization: singular matrix.");
+      }
+
+      pivots[k] = p;
+      if (p != k) {
+        for (std::size_t j = 0; j < n; ++j) {
+          std::swap(lu(k, j), lu(p, j));
+        }
+      }
+
+      for (std::size_t i = k + 1; i < n; ++i) {
+        double l_ik = lu(i, k) / lu(k, k);
+        lu(i, k) = l_ik;
+        for (std::size_t j = k + 1; j < n; ++j) {
+          lu(i, j) -= l_ik * lu(k, j);
+        }
+      }
+    }
+  }
+
+  /// Overwrite `b` with the solution `x` of `A x = b`.
+  void solve(Span<double> b) const {
+    std::size_t n = lu.size();
+    assert(b.size() == n);
+
+    for (std::size_t k = 0; k < n; ++k) {
+      std::swap(b[k], b[pivots[k]]);
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < i; ++j) {
+        b[i] -= lu(i, j) * b[j];
+      }
+    }
+
+    for (std::size_t i = n; i-- > 0;) {
+      for (std::size_t j = i + 1; j < n; ++j) {
+        b[i] -= lu(i, j) * b[j];
+      }
+      b[i] /= lu(i, i);
+    }
+  }
+
+private:
+  DenseMatrix lu;
+  std::vector<std::size_t> pivots;
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+// Embedded Runge-Kutta pairs compute two approximations of different order
+// from the same stages. Their difference estimates the local error of the
+// lower order one, at no additional cost. That's what makes adaptive time
+// stepping cheap, see `solve_ode_adaptive.hpp`.
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// Interface of one step of an embedded RK pair.
+///
+/// Many pairs are "first same as last" (FSAL): the last stage is the RHS at
+/// the new state, i.e. the first stage of the next step. To reuse it, the
+/// rate of change at the start of the step is passed in and the rate of change
+/// at the end of the step is passed out.
+class EmbeddedRKStep : public RKStep {
+public:
+  /// Compute `dydt = f(y, t)`, i.e. the first stage of a step.
+  virtual void first_stage(Span<double> dydt,
+                           Span<const double> y,
+                           double t) const = 0;
+
+  /// Advance `y0` to `y1` and store an estimate of the local error in `y_err`.
+  ///
+  /// On entry `dydt0` must be `f(y0, t)`. On exit `dydt1` is `f(y1, t + dt)`.
+  void advance_with_error(Span<double> y1,
+                          Span<double> y_err,
+                          Span<double> dydt1,
+                          Span<const double> y0,
+                          Span<const double> dydt0,
+                          double t,
+                          double dt,
+                          Workspace &workspace) const {
+    auto scope = instrument(
+        *this, "advance_with_error", 5 * y0.size() * sizeof(double));
+    do_advance_with_error(y1, y_err, dydt1, y0, dydt0, t, dt, workspace);
+  }
+
+  /// Order of the error estimate, i.e. of the lower order method.
+  virtual int error_order() const = 0;
+
+protected:
+  virtual void do_advance_with_error(Span<double> y1,
+                                     Span<double> y_err,
+                                     Span<double> dydt1,
+                                     Span<const double> y0,
+                                     Span<const double> dydt0,
+                                     double t,
+                                     double dt,
+                                     Workspace &workspace) const = 0;
+};
+
+/// The Dormand-Prince 5(4) pair, the method behind `ode45` and `dopri5`.
+///
+/// It advances with the fifth order solution (local extrapolation) and uses
+/// the embedded fourth order solution to estimate the error.
+class DormandPrinceStep : public EmbeddedRKStep {
+public:
+  ~DormandPrinceStep() override = default;
+
+  explicit DormandPrinceStep(std::shared_ptr<RHS> rhs)
+      : rhs(std::move(rhs)) {}
+
+  void first_stage(Span<double> dydt,
+                   Span<const double> y,
+                   double t) const override {
+    (*rhs)(dydt, y, t);
+  }
+
+  int error_order() const override { return 4; }
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    // Slots 0, ..., 5 are used by `advance_with_error`.
+    std::size_t n = y0.size();
+    auto &dydt0 = workspace.vector(6, n);
+    auto &dydt1 = workspace.vector(7, n);
+    auto &y_err = workspace.vector(8, n);
+
+    first_stage(dydt0, y0, t);
+    advance_with_error(y1, y_err, dydt1, y0, dydt0, t, dt, workspace);
+  }
+
+  void do_advance_with_error(Span<double> y1,
+                             Span<double> y_err,
+                             Span<double> k7,
+                             Span<const double> y0,
+                             Span<const double> k1,
+                             double t,
+                             double dt,
+                             Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+    std::size_t n = y0.size();
+
+    auto &k2 = workspace.vector(0, n);
+    auto &k3 = workspace.vector(1, n);
+    auto &k4 = workspace.vector(2, n);
+    auto &k5 = workspace.vector(3, n);
+    auto &k6 = workspace.vector(4, n);
+    auto &y_stage = workspace.vector(5, n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      y_stage[i] = y0[i] + dt * (a21 * k1[i]);
+    }
+    (*rhs)(k2, y_stage, t + c2 * dt);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      y_stage[i] = y0[i] + dt * (a31 * k1[i] + a32 * k2[i]);
+    }
+    (*rhs)(k3, y_stage, t + c3 * dt);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      y_stage[i] = y0[i] + dt * (a41 * k1[i] + a42 * k2[i] + a43 * k3[i]);
+    }
+    (*rhs)(k4, y_stage, t + c4 * dt);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      y_stage[i] = y0[i]
+                   + dt
+                         * (a51 * k1[i] + a52 * k2[i] + a53 * k3[i]
+                            + a54 * k4[i]);
+    }
+    (*rhs)(k5, y_stage, t + c5 * dt);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      y_stage[i] = y0[i]
+                   + dt
+                         * (a61 * k1[i] + a62 * k2[i] + a63 * k3[i]
+                            + a64 * k4[i] + a65 * k5[i]);
+    }
+    (*rhs)(k6, y_stage, t + dt);
+
+    // The seventh stage is evaluated at the fifth order solution.
+    for (std::size_t i = 0; i < n; ++i) {
+      y1[i] = y0[i]
+              + dt
+                    * (b1 * k1[i] + b3 * k3[i] + b4 * k4[i] + b5 * k5[i]
+                       + b6 * k6[i]);
+    }
+    (*rhs)(k7, y1, t + dt);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      y_err[i] = dt
+                 * (e1 * k1[i] + e3 * k3[i] + e4 * k4[i] + e5 * k5[i]
+                    + e6 * k6[i] + e7 * k7[i]);
+    }
+  }
+
+private:
+  static constexpr double c2 = 1.0 / 5.0;
+  static constexpr double c3 = 3.0 / 10.0;
+  static constexpr double c4 = 4.0 / 5.0;
+  static constexpr double c5 = 8.0 / 9.0;
+
+  static constexpr double a21 = 1.0 / 5.0;
+  static constexpr double a31 = 3.0 / 40.0;
+  static constexpr double a32 = 9.0 / 40.0;
+  static constexpr double a41 = 44.0 / 45.0;
+  static constexpr double a42 = -56.0 / 15.0;
+  static constexpr double a43 = 32.0 / 9.0;
+  static constexpr double a51 = 19372.0 / 6561.0;
+  static constexpr double a52 = -25360.0 / 2187.0;
+  static constexpr double a53 = 64448.0 / 6561.0;
+  static constexpr double a54 = -212.0 / 729.0;
+  static constexpr double a61 = 9017.0 / 3168.0;
+  static constexpr double a62 = -355.0 / 33.0;
+  static constexpr double a63 = 46732.0 / 5247.0;
+  static constexpr double a64 = 49.0 / 176.0;
+  static constexpr double a65 = -5103.0 / 18656.0;
+
+  // The fifth order weights; also the last row of the tableau (FSAL).
+  static constexpr double b1 = 35.0 / 384.0;
+  static constexpr double b3 = 500.0 / 1113.0;
+  static constexpr double b4 = 125.0 / 192.0;
+  static constexpr double b5 = -2187.0 / 6784.0;
+  static constexpr double b6 = 11.0 / 84.0;
+
+  // Difference between the fifth and fourth order weights.
+  static constexpr double e1 = 71.0 / 57600.0;
+  static constexpr double e3 = -71.0 / 16695.0;
+  static constexpr double e4 = 71.0 / 1920.0;
+  static constexpr double e5 = -17253.0 / 339200.0;
+  static constexpr double e6 = 22.0 / 525.0;
+  static constexpr double e7 = -1.0 / 40.0;
+
+  std::shared_ptr<RHS> rhs;
+};
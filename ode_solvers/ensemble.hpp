@@ -0,0 +1,95 @@
+#pragma once
+
+// In a Monte Carlo setting we solve the same ODE for many initial conditions.
+// Solving them one after the other means one virtual `advance` and one virtual
+// RHS call per member and step, and loops of length `n_vars`, e.g. three,
+// which are far too short to vectorize.
+//
+// Instead we advance `n_members` states together. The layout is
+// member-innermost (struct of arrays):
+//
+//   data = [y_0 of member 0, ..., y_0 of member K-1,
+//           y_1 of member 0, ..., y_1 of member K-1,
+//           ...]
+//
+// The batch is still a single `std::vector`, hence every `RHS` and
+// `RKStep` can be used unmodified. One RHS dispatch then covers the whole batch
+// and the update loops have length `n_vars * n_members`.
+//
+// A pointwise RHS like `ExpRHS` works out of the box. An RHS which couples the
+// variables must be written as
+//
+//   for (i = 0; i < n_vars; ++i) {
+//     for (k = 0; k < n_members; ++k) {
+//       dydt[i * n_members + k] = f_i(y[0 * n_members + k], ...);
+//     }
+//   }
+//
+// i.e. with the loop over members innermost. It's contiguous and the
+// iterations are independent, which is exactly what vectorizes. This is
+// `BatchLayout::variable_major`, see `RHS::eval_batch`.
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+
+/// A batch of `n_members` states with `n_vars` variables each.
+template <class Scalar>
+class BasicEnsemble {
+public:
+  BasicEnsemble(std::size_t n_vars, std::size_t n_members)
+      : n_vars_(n_vars), n_members_(n_members), data_(n_vars * n_members) {}
+
+  std::size_t n_vars() const { return n_vars_; }
+  std::size_t n_members() const { return n_members_; }
+
+  /// Variable `i` of member `k`.
+  Scalar &operator()(std::size_t i, std::size_t k) {
+    return data_[i * n_members_ + k];
+  }
+
+  Scalar operator()(std::size_t i, std::size_t k) const {
+    return data_[i * n_members_ + k];
+  }
+
+  /// Copy the state `y` of a single member into the batch.
+  void set_member(std::size_t k, const std::vector<Scalar> &y) {
+    assert(y.size() == n_vars_);
+    for (std::size_t i = 0; i < n_vars_; ++i) {
+      (*this)(i, k) = y[i];
+    }
+  }
+
+  /// Copy the state of a single member out of the batch.
+  std::vector<Scalar> member(std::size_t k) const {
+    auto y = std::vector<Scalar>(n_vars_);
+    for (std::size_t i = 0; i < n_vars_; ++i) {
+      y[i] = (*this)(i, k);
+    }
+    return y;
+  }
+
+  /// The packed state, this is what the `RKStep` sees.
+  std::vector<Scalar> &data() { return data_; }
+  const std::vector<Scalar> &data() const { return data_; }
+
+private:
+  std::size_t n_vars_;
+  std::size_t n_members_;
+  std::vector<Scalar> data_;
+};
+
+using Ensemble = BasicEnsemble<double>;
+
+/// Integrate all members of `y0` from `t = 0` to `T`.
+template <class Scalar>
+BasicEnsemble<Scalar> solve_ode(const BasicRKStep<Scalar> &rk_step,
+                                BasicEnsemble<Scalar> y0,
+                                double T,
+                                double dt) {
+  y0.data() = solve_ode(rk_step, std::move(y0.data()), T, dt);
+  return y0;
+}
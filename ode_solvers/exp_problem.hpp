@@ -0,0 +1,25 @@
+#pragma once
+
+// Initial condition and exact solution of dy/dt = -2 y, i.e. of `ExpRHS`.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+inline std::vector<double> ic() { return std::vector<double>{1.0, 2.0, 3.0}; }
+
+inline std::vector<double> soln(double t) {
+  double e = std::exp(-2.0 * t);
+  return std::vector<double>{1.0 * e, 2.0 * e, 3.0 * e};
+}
+
+/// Largest absolute difference between two states, in double precision.
+template <class Scalar>
+double max_error(const std::vector<Scalar> &y,
+                 const std::vector<double> &y_exact) {
+  double err = 0.0;
+  for (std::size_t i = 0; i < y.size(); ++i) {
+    err = std::max(err, std::abs(double(y[i]) - y_exact[i]));
+  }
+  return err;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+// Exponential integrators for semilinear problems
+//
+//   dy_i/dt = lambda_i * y_i + N_i(y, t),
+//
+// i.e. RHS with a diagonal linear part, see `RHS::linear_part`. The linear
+// part is integrated exactly via the functions
+//
+//   phi_1(z) = (e^z - 1) / z,    phi_2(z) = (e^z - 1 - z) / z^2,
+//
+// and only the rest `N` is approximated. Hence, stiffness in `lambda` doesn't
+// restrict `dt`, only the dynamics of `N` do. If `N = 0`, e.g. for `ExpRHS`, a
+// single step of any size is exact up to rounding.
+//
+// Since `e^z = 1 + z * phi_1(z)`, exponential Euler can be written in terms of
+// `f` instead of `N`:
+//
+//   y1 = e^(dt * lambda) * y0 + dt * phi_1(dt * lambda) * N(y0, t)
+//      = y0 + dt * phi_1(dt * lambda) * f(y0, t).
+//
+// The coefficients only depend on `dt * lambda`. Computing them costs an
+// `expm1` per unknown, hence they're cached in the workspace and only
+// recomputed if `dt` or `lambda` change.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// `phi_1(z) = (e^z - 1) / z`, continued by `phi_1(0) = 1`.
+inline double phi1(double z) { return z == 0.0 ? 1.0 : std::expm1(z) / z; }
+
+/// `phi_2(z) = (e^z - 1 - z) / z^2`, continued by `phi_2(0) = 1 / 2`.
+inline double phi2(double z) {
+  // The formula cancels catastrophically for small `z`, its Taylor series
+  // doesn't.
+  if (std::abs(z) < 1e-2) {
+    // `phi_2(z) = sum_k z^k / (k + 2)!`, the terms decay faster than `z^k`.
+    double term = 0.5;
+    double sum = term;
+    for (int k = 1; k <= 6; ++k) {
+      term *= z / double(k + 2);
+      sum += term;
+    }
+    return sum;
+  }
+
+  return (std::expm1(z) - z) / (z * z);
+}
+
+/// The coefficients of an exponential step, `dt * phi_k(dt * lambda)`.
+///
+/// Persists in the workspace between steps.
+struct ExponentialCoefficients {
+  std::size_t owner = 0;
+  double dt = 0.0;
+
+  std::vector<double> lambda;
+  std::vector<double> dt_phi1;
+  std::vector<double> dt_phi2;
+
+  // The linear part of the current step, before it's compared to `lambda`.
+  std::vector<double> lambda_next;
+};
+
+/// The linear part of `rhs` at `t` and the matching coefficients; only
+/// recomputed if `lambda` or `dt` changed since the last step of `owner`.
+///
+/// Uses the state slot 2 of the workspace.
+inline const ExponentialCoefficients &
+exponential_coefficients(const RHS &rhs,
+                         std::size_t owner,
+                         std::size_t n,
+                         double t,
+                         double dt,
+                         Workspace &workspace) {
+  auto &c = workspace.state<ExponentialCoefficients>(2);
+
+  c.lambda_next.resize(n);
+  if (!rhs.linear_part(c.lambda_next, t)) {
+    throw std::invalid_argument(
+        "Exponential integrators need a RHS with a linear part.");
+  }
+
+  if (c.owner == owner && c.dt == dt && c.lambda == c.lambda_next) {
+    return c;
+  }
+
+  c.owner = owner;
+  c.dt = dt;
+  std::swap(c.lambda, c.lambda_next);
+  c.dt_phi1.resize(n);
+  c.dt_phi2.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    double z = dt * c.lambda[i];
+    c.dt_phi1[i] = dt * phi1(z);
+    c.dt_phi2[i] = dt * phi2(z);
+  }
+
+  return c;
+}
+
+/// Exponential Euler (ETD1), first order.
+///
+/// Uses the vector slot 0 of the workspace.
+class ExponentialEulerStep : public RKStep {
+public:
+  explicit ExponentialEulerStep(std::shared_ptr<RHS> rhs)
+      : rhs(std::move(rhs)), id(make_workspace_owner_id()) {}
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+    std::size_t n = y0.size();
+
+    const auto &c = exponential_coefficients(*rhs, id, n, t, dt, workspace);
+
+    auto &f0 = workspace.vector(0, n);
+    (*rhs)(f0, y0, t);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      y1[i] = y0[i] + c.dt_phi1[i] * f0[i];
+    }
+  }
+
+private:
+  std::shared_ptr<RHS> rhs;
+  std::size_t id;
+};
+
+/// The second order exponential RK scheme of Cox and Matthews (ETD2RK):
+///
+///   a  = y0 + dt * phi_1 * f(y0, t)
+///   y1 = a + dt * phi_2 * (N(a, t + dt) - N(y0, t))
+///
+/// with `N(a) - N(y0) = f(a) - f(y0) - lambda * (a - y0)`. The linear part
+/// is frozen at `t` for the whole step.
+///
+/// Uses the vector slots 0 and 1 of the workspace.
+class ETDRK2Step : public RKStep {
+public:
+  explicit ETDRK2Step(std::shared_ptr<RHS> rhs)
+      : rhs(std::move(rhs)), id(make_workspace_owner_id()) {}
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+    std::size_t n = y0.size();
+
+    const auto &c = exponential_coefficients(*rhs, id, n, t, dt, workspace);
+
+    auto &f0 = workspace.vector(0, n);
+    auto &f1 = workspace.vector(1, n);
+    (*rhs)(f0, y0, t);
+
+    // `y1` holds the stage `a` until it's corrected.
+    for (std::size_t i = 0; i < n; ++i) {
+      y1[i] = y0[i] + c.dt_phi1[i] * f0[i];
+    }
+    (*rhs)(f1, y1, t + dt);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      double dN = f1[i] - f0[i] - c.lambda[i] * (y1[i] - y0[i]);
+      y1[i] += c.dt_phi2[i] * dN;
+    }
+  }
+
+private:
+  std::shared_ptr<RHS> rhs;
+  std::size_t id;
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+// Implicit-explicit (IMEX) additive Runge-Kutta schemes for RHS which split as
+//
+//   f(y, t) = f_E(y, t) + f_I(y, t)
+//
+// into a non-stiff part `f_E`, e.g. a nonlinear reaction, and a stiff part
+// `f_I`, e.g. linear diffusion. Explicit schemes treat all of `f` explicitly
+// and need `dt` below the stability limit of `f_I`. Implicit schemes solve
+// nonlinear systems in all of `f`, including a Jacobian of `f_E` which
+// changes every step. An additive RK scheme uses two tableaus on the same
+// stages: an explicit one for `f_E` and a diagonally implicit one for `f_I`.
+// Only `f_I` enters the Newton iteration; if it's linear, its Jacobian is
+// constant and the factorization is reused for the whole trajectory. Hence,
+// `dt` is limited by the dynamics of `f_E` only.
+//
+// Stage `s` is
+//
+//   Y_s = y0 + dt sum_{j < s} (aE[s][j] kE_j + aI[s][j] kI_j)
+//            + dt aI[s][s] f_I(Y_s, t + c[s] dt)
+//
+// with `kE_j = f_E(Y_j, ...)` and `kI_j = f_I(Y_j, ...)`; and
+//
+//   y1 = y0 + dt sum_j (bE[j] kE_j + bI[j] kI_j).
+//
+// A scheme is a class with the tableaus as `static constexpr` members, like
+// the explicit ones in `butcher_tableau.hpp`.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+#include "implicit.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// A RHS split into a non-stiff part, treated explicitly, and a stiff part,
+/// treated implicitly. The RHS is their sum.
+struct SplitRHS {
+  std::shared_ptr<RHS> non_stiff;
+  std::shared_ptr<RHS> stiff;
+};
+
+/// IMEX Euler: Forward Euler in `f_E`, Backward Euler in `f_I`; first order.
+/// Also known as ARS(1,1,1).
+struct IMEXEulerTableau {
+  static constexpr std::size_t n_stages = 2;
+  static constexpr int order = 1;
+  static constexpr double a_explicit[2][2] = {{0.0, 0.0}, {1.0, 0.0}};
+  static constexpr double a_implicit[2][2] = {{0.0, 0.0}, {0.0, 1.0}};
+  static constexpr double b_explicit[2] = {1.0, 0.0};
+  static constexpr double b_implicit[2] = {0.0, 1.0};
+  static constexpr double c[2] = {0.0, 1.0};
+};
+
+/// ARK3(2)4L[2]SA of Kennedy and Carpenter, "Additive Runge-Kutta schemes for
+/// convection-diffusion-reaction equations", Appl. Numer. Math. 44, 2003.
+///
+/// Third order in the non-stiff limit; the implicit part is L-stable and
+/// stiffly accurate, with an explicit first stage and the same `gamma` on the
+/// rest of the diagonal.
+///
+/// The stage order is lower. If `f_I` is stiff, the stages aren't resolved
+/// and the observed order drops below three (order reduction). E.g. for the
+/// stiff diffusion of `usecase_imex` it's about 2.75.
+struct ARK324Tableau {
+  static constexpr std::size_t n_stages = 4;
+  static constexpr int order = 3;
+
+  static constexpr double gamma = 1767732205903.0 / 4055673282236.0;
+
+  static constexpr double a_explicit[4][4]
+      = {{0.0, 0.0, 0.0, 0.0},
+         {1767732205903.0 / 2027836641118.0, 0.0, 0.0, 0.0},
+         {5535828885825.0 / 10492691773637.0,
+          788022342437.0 / 10882634858940.0,
+          0.0,
+          0.0},
+         {6485989280629.0 / 16251701735622.0,
+          -4246266847089.0 / 9704473918619.0,
+          10755448449292.0 / 10357097424841.0,
+          0.0}};
+
+  static constexpr double a_implicit[4][4]
+      = {{0.0, 0.0, 0.0, 0.0},
+         {gamma, gamma, 0.0, 0.0},
+         {2746238789719.0 / 10658868560708.0,
+          -640167445237.0 / 6845629431997.0,
+          gamma,
+          0.0},
+         {1471266399579.0 / 7840856788654.0,
+          -4482444167858.0 / 7529755066697.0,
+          11266239266428.0 / 11593286722821.0,
+          gamma}};
+
+  static constexpr double b_explicit[4] = {a_implicit[3][0],
+                                           a_implicit[3][1],
+                                           a_implicit[3][2],
+                                           a_implicit[3][3]};
+
+  static constexpr double b_implicit[4] = {a_implicit[3][0],
+                                           a_implicit[3][1],
+                                           a_implicit[3][2],
+                                           a_implicit[3][3]};
+
+  static constexpr double c[4]
+      = {0.0, 1767732205903.0 / 2027836641118.0, 0.6, 1.0};
+};
+
+/// Is `Tableau` an IMEX pair, i.e. `a_explicit` strictly lower triangular,
+/// `a_implicit` lower triangular, both consistent with `c` and both `b`
+/// summing to one, up to rounding?
+template <class Tableau>
+constexpr bool is_imex_tableau() {
+  constexpr std::size_t S = Tableau::n_stages;
+  auto is_close = [](double x, double y) {
+    double d = x - y;
+    return -1e-14 <= d && d <= 1e-14;
+  };
+
+  double sum_b_explicit = 0.0;
+  double sum_b_implicit = 0.0;
+  for (std::size_t s = 0; s < S; ++s) {
+    double sum_a_explicit = 0.0;
+    double sum_a_implicit = 0.0;
+    for (std::size_t j = 0; j < S; ++j) {
+      if (j >= s && Tableau::a_explicit[s][j] != 0.0) {
+        return false;
+      }
+
+      if (j > s && Tableau::a_implicit[s][j] != 0.0) {
+        return false;
+      }
+
+      sum_a_explicit += Tableau::a_explicit[s][j];
+      sum_a_implicit += Tableau::a_implicit[s][j];
+    }
+
+    if (!is_close(sum_a_explicit, Tableau::c[s])
+        || !is_close(sum_a_implicit, Tableau::c[s])) {
+      return false;
+    }
+
+    sum_b_explicit += Tableau::b_explicit[s];
+    sum_b_implicit += Tableau::b_implicit[s];
+  }
+
+  return is_close(sum_b_explicit, 1.0) && is_close(sum_b_implicit, 1.0);
+}
+
+/// The IMEX additive RK step with the tableaus `Tableau`.
+///
+/// The stages are solved by the simplified Newton iteration of
+/// `implicit.hpp`, in the stiff part only. Uses the vector slots
+/// `0, ..., 2 * n_stages + 5` and the state slot 0 of the workspace.
+template <class Tableau>
+class IMEXARKStep : public RKStep {
+private:
+  static constexpr std::size_t n_stages = Tableau::n_stages;
+  static_assert(is_imex_tableau<Tableau>(),
+                "Tableau isn't an IMEX pair, or isn't consistent.");
+
+public:
+  explicit IMEXARKStep(SplitRHS rhs, NewtonOptions options = NewtonOptions{})
+      : non_stiff(std::move(rhs.non_stiff)),
+        stiff(rhs.stiff),
+        newton(std::move(rhs.stiff), options),
+        id(make_workspace_owner_id()) {
+    if (non_stiff == nullptr || stiff == nullptr) {
+      throw std::invalid_argument("IMEXARKStep: missing part of the RHS.");
+    }
+  }
+
+  static constexpr int order() { return Tableau::order; }
+
+  /// The Newton statistics of the trajectory computed with `workspace`.
+  const NewtonStats &newton_stats(Workspace &workspace) const {
+    return cache(workspace).stats;
+  }
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+    std::size_t n = y0.size();
+
+    // Vector slots `0, ..., 4` are used by Newton. `y1` holds the stages
+    // until the final combination.
+    auto &b = workspace.vector(5, n);
+    auto k_explicit = [&](std::size_t j) -> Span<double> {
+      return workspace.vector(6 + j, n);
+    };
+    auto k_implicit = [&](std::size_t j) -> Span<double> {
+      return workspace.vector(6 + n_stages + j, n);
+    };
+
+    for (std::size_t s = 0; s < n_stages; ++s) {
+      double t_stage = t + Tableau::c[s] * dt;
+
+      std::copy(y0.begin(), y0.end(), b.begin());
+      for (std::size_t j = 0; j < s; ++j) {
+        add_scaled(b, dt * Tableau::a_explicit[s][j], k_explicit(j));
+        add_scaled(b, dt * Tableau::a_implicit[s][j], k_implicit(j));
+      }
+
+      std::copy(b.begin(), b.end(), y1.begin());
+      double gamma_dt = Tableau::a_implicit[s][s] * dt;
+      if (gamma_dt != 0.0) {
+        newton.solve(y1, b, gamma_dt, t_stage, cache(workspace), workspace);
+      }
+
+      if (is_used(Tableau::a_explicit, Tableau::b_explicit, s)) {
+        (*non_stiff)(k_explicit(s), y1, t_stage);
+      }
+
+      if (is_used(Tableau::a_implicit, Tableau::b_implicit, s)) {
+        (*stiff)(k_implicit(s), y1, t_stage);
+      }
+    }
+
+    std::copy(y0.begin(), y0.end(), y1.begin());
+    for (std::size_t j = 0; j < n_stages; ++j) {
+      add_scaled(y1, dt * Tableau::b_explicit[j], k_explicit(j));
+      add_scaled(y1, dt * Tableau::b_implicit[j], k_implicit(j));
+    }
+  }
+
+private:
+  // `y += alpha * k`, nothing if `alpha == 0`.
+  static void add_scaled(Span<double> y, double alpha, Span<const double> k) {
+    if (alpha != 0.0) {
+      for (std::size_t i = 0; i < y.size(); ++i) {
+        y[i] += alpha * k[i];
+      }
+    }
+  }
+
+  // Does any later stage, or the update, use stage `s`?
+  static constexpr bool is_used(const double (&a)[n_stages][n_stages],
+                                const double (&b)[n_stages],
+                                std::size_t s) {
+    for (std::size_t r = s + 1; r < n_stages; ++r) {
+      if (a[r][s] != 0.0) {
+        return true;
+      }
+    }
+    return b[s] != 0.0;
+  }
+
+  NewtonCache &cache(Workspace &workspace) const {
+    auto &c = workspace.state<NewtonCache>(0);
+    if (c.owner != id) {
+      c = NewtonCache{};
+      c.owner = id;
+    }
+    return c;
+  }
+
+  std::shared_ptr<RHS> non_stiff;
+  std::shared_ptr<RHS> stiff;
+  NewtonSolver newton;
+  std::size_t id;
+};
+
+using IMEXEulerStep = IMEXARKStep<IMEXEulerTableau>;
+using ARK324Step = IMEXARKStep<ARK324Tableau>;
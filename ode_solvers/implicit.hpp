@@ -0,0 +1,386 @@
+#pragma once
+
+// If the eigenvalues of the Jacobian are of size 1e6, explicit schemes are
+// only stable if `dt` is of size 1e-6, even if the solution itself varies
+// slowly. Implicit schemes are stable for much larger `dt`, at the cost of
+// solving a nonlinear system
+//
+//   y1 - gamma * dt * f(y1, t1) = b
+//
+// every step. We use a simplified Newton iteration: the matrix
+// `I - gamma * dt * J` is factorized once and the factorization is reused for
+// many iterations and many steps. The Jacobian `J` is only recomputed if Newton
+// converges slowly, or if it's older than a given number of steps.
+//
+// The Jacobian, its factorization and the history of multistep methods persist
+// between steps, they're stored in the workspace.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "dense_matrix.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// Parameters of the simplified Newton iteration.
+struct NewtonOptions {
+  double atol = 1e-10;
+  double rtol = 1e-10;
+  int max_iter = 10;
+
+  /// Recompute the Jacobian at least every so many steps.
+  std::size_t max_jacobian_age = 50;
+};
+
+/// Counts of the expensive parts of the Newton iteration.
+struct NewtonStats {
+  std::size_t n_iterations = 0;
+  std::size_t n_jacobians = 0;
+  std::size_t n_factorizations = 0;
+};
+
+/// How many perturbed states `finite_difference_jacobian` evaluates per batch.
+constexpr std::size_t finite_difference_batch_size = 16;
+
+/// Approximate `df/dy` by forward differences, costs `n + 1` RHS evaluations.
+///
+/// The perturbed states are evaluated in batches, see `RHS::eval_batch`. The
+/// vector `f0` is a scratch pad of size `n`; `f1` and `y_pert` of size `n`
+/// times the batch size, which is capped by their size.
+inline void finite_difference_jacobian(DenseMatrix &dfdy,
+                                       const RHS &rhs,
+                                       Span<const double> y,
+                                       double t,
+                                       Span<double> f0,
+                                       Span<double> f1,
+                                       Span<double> y_pert) {
+  std::size_t n = y.size();
+  dfdy.resize(n);
+  if (n == 0) {
+    return;
+  }
+
+  std::size_t batch_size = std::min(f1.size(), y_pert.size()) / n;
+  assert(batch_size > 0);
+
+  rhs(f0, y, t);
+  for (std::size_t j0 = 0; j0 < n; j0 += batch_size) {
+    // State `k` of the batch is `y` perturbed in component `j0 + k`.
+    std::size_t n_states = std::min(batch_size, n - j0);
+    for (std::size_t k = 0; k < n_states; ++k) {
+      auto y_k = y_pert.subspan(k * n, n);
+      std::copy(y.begin(), y.end(), y_k.begin());
+      y_k[j0 + k] += 1.5e-8 * std::max(std::abs(y[j0 + k]), 1.0);
+    }
+
+    rhs.eval_batch(f1.subspan(0, n_states * n),
+                   y_pert.subspan(0, n_states * n),
+                   t,
+                   n_states,
+                   BatchLayout::state_major);
+
+    for (std::size_t k = 0; k < n_states; ++k) {
+      std::size_t j = j0 + k;
+      // The perturbation as it's represented, not as it's intended.
+      double eps = y_pert[k * n + j] - y[j];
+      for (std::size_t i = 0; i < n; ++i) {
+        dfdy(i, j) = (f1[k * n + i] - f0[i]) / eps;
+      }
+    }
+  }
+}
+
+/// The part of the Newton iteration which persists between steps.
+struct NewtonCache {
+  std::size_t owner = 0;
+
+  DenseMatrix dfdy;
+  DenseMatrix matrix;
+  LUFactorization lu;
+
+  /// `lu` is the factorization of `I - gamma_dt * dfdy`.
+  double gamma_dt = 0.0;
+
+  bool has_jacobian = false;
+  bool has_lu = false;
+  std::size_t jacobian_age = 0;
+
+  NewtonStats stats;
+};
+
+/// Solves `y - gamma_dt * f(y, t) = b` by a simplified Newton iteration.
+///
+/// Uses the vector slots `0, ..., 4` of the workspace.
+class NewtonSolver {
+public:
+  NewtonSolver(std::shared_ptr<RHS> rhs, NewtonOptions options)
+      : rhs(std::move(rhs)), options(options) {}
+
+  /// On entry `y` is the initial guess, on exit the solution.
+  void solve(Span<double> y,
+             Span<const double> b,
+             double gamma_dt,
+             double t,
+             NewtonCache &cache,
+             Workspace &workspace) const {
+    std::size_t n = y.size();
+    auto &delta = workspace.vector(0, n);
+    auto &y_guess = workspace.vector(1, n);
+    std::copy(y.begin(), y.end(), y_guess.begin());
+
+    bool is_fresh = false;
+    if (!cache.has_jacobian || cache.jacobian_age >= options.max_jacobian_age) {
+      update_jacobian(y, t, cache, workspace);
+      is_fresh = true;
+    }
+    cache.jacobian_age += 1;
+
+    while (true) {
+      if (!cache.has_lu || cache.gamma_dt != gamma_dt) {
+        factorize(gamma_dt, cache);
+      }
+
+      if (iterate(y, delta, b, gamma_dt, t, cache)) {
+        return;
+      }
+
+      // If even a fresh Jacobian doesn't help, `dt` is too large.
+      if (is_fresh) {
+        throw std::runtime_error("NewtonSolver: no convergence.");
+      }
+
+      std::copy(y_guess.begin(), y_guess.end(), y.begin());
+      update_jacobian(y, t, cache, workspace);
+      is_fresh = true;
+    }
+  }
+
+private:
+  bool iterate(Span<double> y,
+               Span<double> delta,
+               Span<const double> b,
+               double gamma_dt,
+               double t,
+               NewtonCache &cache) const {
+    double err_prev = 0.0;
+    for (int iter = 0; iter < options.max_iter; ++iter) {
+      cache.stats.n_iterations += 1;
+
+      // delta = -(y - gamma_dt * f(y, t) - b)
+      (*rhs)(delta, y, t);
+      for (std::size_t i = 0; i < y.size(); ++i) {
+        delta[i] = b[i] + gamma_dt * delta[i] - y[i];
+      }
+
+      cache.lu.solve(delta);
+
+      double err = 0.0;
+      for (std::size_t i = 0; i < y.size(); ++i) {
+        y[i] += delta[i];
+        double scale = options.atol + options.rtol * std::abs(y[i]);
+        err = std::max(err, std::abs(delta[i]) / scale);
+      }
+
+      if (err <= 1.0) {
+        return true;
+      }
+
+      // Converging too slowly, probably the Jacobian is stale.
+      if (iter > 0 && err > 0.9 * err_prev) {
+        return false;
+      }
+      err_prev = err;
+    }
+
+    return false;
+  }
+
+  void update_jacobian(Span<const double> y,
+                       double t,
+                       NewtonCache &cache,
+                       Workspace &workspace) const {
+    if (!rhs->jacobian(cache.dfdy, y, t)) {
+      std::size_t n = y.size();
+      std::size_t batch = std::min(n, finite_difference_batch_size) * n;
+      finite_difference_jacobian(cache.dfdy,
+                                 *rhs,
+                                 y,
+                                 t,
+                                 workspace.vector(2, n),
+                                 workspace.vector(3, batch),
+                                 workspace.vector(4, batch));
+    }
+
+    cache.has_jacobian = true;
+    cache.has_lu = false;
+    cache.jacobian_age = 0;
+    cache.stats.n_jacobians += 1;
+  }
+
+  void factorize(double gamma_dt, NewtonCache &cache) const {
+    std::size_t n = cache.dfdy.size();
+    cache.matrix.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        cache.matrix(i, j) = (i == j ? 1.0 : 0.0) - gamma_dt * cache.dfdy(i, j);
+      }
+    }
+
+    cache.lu.factorize(cache.matrix);
+    cache.gamma_dt = gamma_dt;
+    cache.has_lu = true;
+    cache.stats.n_factorizations += 1;
+  }
+
+  std::shared_ptr<RHS> rhs;
+  NewtonOptions options;
+};
+
+/// One step of Backward Euler, `y1 = y0 + dt * f(y1, t + dt)`.
+class BackwardEulerStep : public RKStep {
+public:
+  explicit BackwardEulerStep(std::shared_ptr<RHS> rhs,
+                             NewtonOptions options = NewtonOptions{})
+      : newton(std::move(rhs), options), id(make_workspace_owner_id()) {}
+
+  /// The Newton statistics of the trajectory computed with `workspace`.
+  const NewtonStats &newton_stats(Workspace &workspace) const {
+    return cache(workspace).stats;
+  }
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+
+    std::copy(y0.begin(), y0.end(), y1.begin());
+    newton.solve(y1, y0, dt, t + dt, cache(workspace), workspace);
+  }
+
+private:
+  NewtonCache &cache(Workspace &workspace) const {
+    auto &c = workspace.state<NewtonCache>(0);
+    if (c.owner != id) {
+      c = NewtonCache{};
+      c.owner = id;
+    }
+    return c;
+  }
+
+  NewtonSolver newton;
+  std::size_t id;
+};
+
+/// The BDF methods of order one and two, with fixed order and step size.
+///
+/// BDF is a multistep method, i.e. it needs the previous states. They're kept
+/// in the workspace. If `advance` is called with the state and time of the
+/// previous step, it continues the trajectory. Otherwise, it starts a new one.
+/// The first step of a trajectory, or the first after a change in `dt`, is
+/// Backward Euler. Its local error is `O(dt^2)`, which doesn't spoil the order
+/// of BDF2.
+///
+/// Higher orders would need a starter of matching accuracy, and pay off only
+/// with error based order and step size selection; without both, the start-up
+/// error dominates and BDF3 to BDF5 aren't more accurate than BDF2.
+class BDFStep : public RKStep {
+public:
+  explicit BDFStep(std::shared_ptr<RHS> rhs,
+                   int order = 2,
+                   NewtonOptions options = NewtonOptions{})
+      : newton(std::move(rhs), options),
+        order(order),
+        id(make_workspace_owner_id()) {
+    if (order < 1 || order > 2) {
+      throw std::invalid_argument("BDFStep: order must be 1 or 2.");
+    }
+  }
+
+  /// The Newton statistics of the trajectory computed with `workspace`.
+  const NewtonStats &newton_stats(Workspace &workspace) const {
+    return cache(workspace).stats;
+  }
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+    std::size_t n = y0.size();
+
+    auto &newton_cache = cache(workspace);
+    auto &history = workspace.state<History>(1);
+
+    bool is_continuation = history.owner == id && !history.y.empty()
+                           && history.t == t && history.dt == dt
+                           && std::equal(y0.begin(), y0.end(),
+                                         history.y[0].begin(),
+                                         history.y[0].end());
+
+    if (!is_continuation) {
+      history.owner = id;
+      history.dt = dt;
+      history.y.assign(1, std::vector<double>(y0.begin(), y0.end()));
+    }
+
+    // `history.y[j]` is the state `j` steps ago.
+    int k = std::min(order, int(history.y.size()));
+
+    // Vector slots `0, ..., 4` are used by Newton.
+    auto &b = workspace.vector(5, n);
+    for (std::size_t i = 0; i < n; ++i) {
+      double b_i = 0.0;
+      for (int j = 0; j < k; ++j) {
+        b_i += alpha[k - 1][j] * history.y[j][i];
+      }
+      b[i] = b_i;
+    }
+
+    std::copy(y0.begin(), y0.end(), y1.begin());
+    newton.solve(y1, b, beta[k - 1] * dt, t + dt, newton_cache, workspace);
+
+    if (int(history.y.size()) < order) {
+      history.y.emplace_back();
+    }
+    std::rotate(history.y.rbegin(), history.y.rbegin() + 1, history.y.rend());
+    history.y[0].assign(y1.begin(), y1.end());
+    history.t = t + dt;
+  }
+
+private:
+  struct History {
+    std::size_t owner = 0;
+    double t = 0.0;
+    double dt = 0.0;
+    std::vector<std::vector<double>> y;
+  };
+
+  NewtonCache &cache(Workspace &workspace) const {
+    auto &c = workspace.state<NewtonCache>(0);
+    if (c.owner != id) {
+      c = NewtonCache{};
+      c.owner = id;
+    }
+    return c;
+  }
+
+  // BDF of order `k` is
+  //   y1 - beta[k-1] * dt * f(y1) = sum_j alpha[k-1][j] * (state j steps ago)
+  static constexpr double alpha[2][2] = {{1.0, 0.0}, {4.0 / 3.0, -1.0 / 3.0}};
+  static constexpr double beta[2] = {1.0, 2.0 / 3.0};
+
+  NewtonSolver newton;
+  int order;
+  std::size_t id;
+};
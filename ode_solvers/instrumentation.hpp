@@ -0,0 +1,247 @@
+#pragma once
+
+// `RHS` and `RKStep` follow the non-virtual interface pattern, see
+// `polymorphism/frequent_patterns.cpp`: the public methods aren't virtual,
+// they call protected virtual `do_*` methods. Hence, the public methods are
+// the one place through which every call to every implementation passes; and
+// that's where the instrumentation goes.
+//
+// For every implementation (the dynamic type of the object) and operation,
+// e.g. `advance` of `BDFStep`, it records
+//
+//   n_calls   the number of calls,
+//   seconds   the cumulative wall clock time spent in the calls,
+//   bytes     the compulsory memory traffic, i.e. every vector argument read
+//             or written once.
+//
+// Times are inclusive, e.g. the `advance` of a step includes the RHS
+// evaluations it performs. The range methods of a `RangeRHS` are recorded once
+// per chunk, on whichever thread computes it; their time adds up over the
+// threads, i.e. it may exceed the wall clock time of the step.
+//
+// Instrumentation is opt-in: define `ODE_SOLVERS_INSTRUMENTATION` (in every
+// translation unit) before including any header. Otherwise, the entry points
+// only forward to the implementation and everything here compiles to nothing;
+// not even the layout of the classes changes.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifdef ODE_SOLVERS_INSTRUMENTATION
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+#endif
+
+/// What was recorded for one operation of one implementation.
+struct InstrumentationRecord {
+  std::string implementation;
+  std::string operation;
+  std::size_t n_calls;
+  double seconds;
+  std::size_t bytes;
+};
+
+#ifdef ODE_SOLVERS_INSTRUMENTATION
+
+constexpr bool instrumentation_enabled = true;
+
+struct InstrumentationCounters {
+  std::atomic<std::size_t> n_calls = 0;
+  std::atomic<std::uint64_t> nanoseconds = 0;
+  std::atomic<std::size_t> bytes = 0;
+};
+
+/// All counters of the process.
+///
+/// Counters are never removed, therefore references to them stay valid. Each
+/// thread caches the references it has seen; and only takes the lock the
+/// first time it sees an implementation.
+class InstrumentationRegistry {
+public:
+  static InstrumentationRegistry &instance() {
+    static InstrumentationRegistry registry;
+    return registry;
+  }
+
+  InstrumentationCounters &counters(const std::type_info &type,
+                                    const char *operation) {
+    thread_local std::unordered_map<Key, InstrumentationCounters *, KeyHash>
+        cache;
+
+    auto key = Key{&type, operation};
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      return *it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &c = registry[{type.name(), operation}];
+    if (c == nullptr) {
+      c = std::make_unique<InstrumentationCounters>();
+    }
+    cache[key] = c.get();
+    return *c;
+  }
+
+  std::vector<InstrumentationRecord> records() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto records = std::vector<InstrumentationRecord>{};
+    for (const auto &[key, c] : registry) {
+      if (c->n_calls.load() == 0) {
+        continue;
+      }
+
+      records.push_back({demangle(key.first),
+                         key.second,
+                         c->n_calls.load(),
+                         double(c->nanoseconds.load()) * 1e-9,
+                         c->bytes.load()});
+    }
+
+    std::sort(records.begin(), records.end(), [](const auto &a, const auto &b) {
+      return std::tie(a.implementation, a.operation)
+             < std::tie(b.implementation, b.operation);
+    });
+
+    return records;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &[key, c] : registry) {
+      c->n_calls = 0;
+      c->nanoseconds = 0;
+      c->bytes = 0;
+    }
+  }
+
+private:
+  using Key = std::pair<const std::type_info *, const char *>;
+
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const {
+      return std::hash<const void *>{}(key.first)
+             ^ (std::hash<const void *>{}(key.second) << 1);
+    }
+  };
+
+  static std::string demangle(const std::string &name) {
+#if defined(__GNUG__)
+    int status = 0;
+    char *s = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (status == 0) {
+      auto demangled = std::string(s);
+      std::free(s);
+      return demangled;
+    }
+#endif
+    return name;
+  }
+
+  // Keyed by name, not by `type_info` address; the address need not be
+  // unique across shared libraries.
+  mutable std::mutex mutex;
+  std::map<std::pair<std::string, std::string>,
+           std::unique_ptr<InstrumentationCounters>>
+      registry;
+};
+
+/// Records one call, with the time from construction to destruction.
+class InstrumentationScope {
+public:
+  InstrumentationScope(const std::type_info &type,
+                       const char *operation,
+                       std::size_t bytes)
+      : counters(InstrumentationRegistry::instance().counters(type, operation)),
+        bytes(bytes),
+        start(std::chrono::steady_clock::now()) {}
+
+  InstrumentationScope(const InstrumentationScope &) = delete;
+  InstrumentationScope &operator=(const InstrumentationScope &) = delete;
+
+  ~InstrumentationScope() {
+    if (is_discarded) {
+      return;
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+
+    counters.n_calls.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    counters.nanoseconds.fetch_add(std::uint64_t(ns.count()),
+                                   std::memory_order_relaxed);
+  }
+
+  /// Don't record this call, e.g. because an optional operation isn't
+  /// supported.
+  void discard() { is_discarded = true; }
+
+private:
+  InstrumentationCounters &counters;
+  std::size_t bytes;
+  std::chrono::steady_clock::time_point start;
+  bool is_discarded = false;
+};
+
+/// Instrument a call of `operation` on `impl`, for the lifetime of the
+/// returned scope.
+template <class Impl>
+InstrumentationScope
+instrument(const Impl &impl, const char *operation, std::size_t bytes) {
+  return InstrumentationScope(typeid(impl), operation, bytes);
+}
+
+/// A snapshot of all operations which were called, sorted by implementation
+/// and operation.
+inline std::vector<InstrumentationRecord> instrumentation_records() {
+  return InstrumentationRegistry::instance().records();
+}
+
+/// Set all counters to zero.
+inline void reset_instrumentation() {
+  InstrumentationRegistry::instance().reset();
+}
+
+#else
+
+constexpr bool instrumentation_enabled = false;
+
+class InstrumentationScope {
+public:
+  // Not trivial, such that unused scopes don't cause warnings.
+  ~InstrumentationScope() {}
+
+  void discard() {}
+};
+
+template <class Impl>
+InstrumentationScope instrument(const Impl & /* impl */,
+                                const char * /* operation */,
+                                std::size_t /* bytes */) {
+  return InstrumentationScope{};
+}
+
+inline std::vector<InstrumentationRecord> instrumentation_records() {
+  return {};
+}
+
+inline void reset_instrumentation() {}
+
+#endif
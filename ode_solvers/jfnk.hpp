@@ -0,0 +1,467 @@
+#pragma once
+
+// The simplified Newton iteration of `implicit.hpp` stores and factorizes the
+// dense matrix `I - gamma_dt * J`. For a method of lines with 10^7 unknowns
+// that's 800 TB, and the factorization O(N^3) operations.
+//
+// Jacobian-free Newton-Krylov (JFNK) never forms `J`. Each Newton correction
+// solves the linear system by GMRES, which only needs products of `J` with a
+// vector; and those are directional finite differences of the RHS:
+//
+//   J v ~= (f(y + eps * v, t) - f(y, t)) / eps.
+//
+// The memory is a handful of vectors plus the Krylov basis, i.e.
+// `krylov_dim + 7` vectors of size N. The price is one RHS evaluation per
+// GMRES iteration, hence the number of iterations is what matters. A
+// `Preconditioner`, an approximate inverse of `I - gamma_dt * J`, reduces it;
+// it's applied from the right such that GMRES minimizes the true residual.
+//
+// Reference: Knoll, Keyes, "Jacobian-free Newton-Krylov methods: a survey of
+// approaches and applications", J. Comput. Phys. 193, 2004.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// An approximate inverse of `I - gamma_dt * df/dy`, for `JFNKSolver`.
+///
+/// Preconditioners are immutable, like steps. Whatever `setup` computes is
+/// stored in the workspace, state slot 4 is reserved for it.
+class Preconditioner {
+public:
+  virtual ~Preconditioner() = default;
+
+  /// Prepare for solves with `I - gamma_dt * df/dy` at `(y, t)`; called once
+  /// per nonlinear solve.
+  void setup(Span<const double> y,
+             double t,
+             double gamma_dt,
+             Workspace &workspace) const {
+    do_setup(y, t, gamma_dt, workspace);
+  }
+
+  /// `z = M^-1 r`.
+  void apply(Span<double> z, Span<const double> r, Workspace &workspace) const {
+    do_apply(z, r, workspace);
+  }
+
+protected:
+  virtual void do_setup(Span<const double> /* y */,
+                        double /* t */,
+                        double /* gamma_dt */,
+                        Workspace & /* workspace */) const {}
+
+  virtual void do_apply(Span<double> z,
+                        Span<const double> r,
+                        Workspace &workspace) const = 0;
+};
+
+/// Jacobi preconditioning by the diagonal linear part of the RHS, see
+/// `RHS::linear_part`, i.e. `z_i = r_i / (1 - gamma_dt * lambda_i)`.
+///
+/// Exact if the RHS is diagonal, e.g. stiff decay; good if the stiffness is
+/// mostly on the diagonal, e.g. a fast reaction with slower diffusion.
+class DiagonalPreconditioner : public Preconditioner {
+public:
+  explicit DiagonalPreconditioner(std::shared_ptr<RHS> rhs)
+      : rhs(std::move(rhs)), id(make_workspace_owner_id()) {}
+
+protected:
+  void do_setup(Span<const double> y,
+                double t,
+                double gamma_dt,
+                Workspace &workspace) const override {
+    auto &c = workspace.state<Cache>(4);
+    c.owner = id;
+    c.inv_diagonal.resize(y.size());
+    if (!rhs->linear_part(c.inv_diagonal, t)) {
+      throw std::invalid_argument(
+          "DiagonalPreconditioner needs a RHS with a linear part.");
+    }
+
+    for (double &d : c.inv_diagonal) {
+      d = 1.0 / (1.0 - gamma_dt * d);
+    }
+  }
+
+  void do_apply(Span<double> z,
+                Span<const double> r,
+                Workspace &workspace) const override {
+    const auto &c = workspace.state<Cache>(4);
+    assert(c.owner == id && c.inv_diagonal.size() == r.size());
+
+    for (std::size_t i = 0; i < r.size(); ++i) {
+      z[i] = c.inv_diagonal[i] * r[i];
+    }
+  }
+
+private:
+  struct Cache {
+    std::size_t owner = 0;
+    std::vector<double> inv_diagonal;
+  };
+
+  std::shared_ptr<RHS> rhs;
+  std::size_t id;
+};
+
+/// Parameters of JFNK.
+struct JFNKOptions {
+  /// Converged once no Newton correction exceeds `atol + rtol * |y|`.
+  double atol = 1e-10;
+  double rtol = 1e-10;
+  int max_newton_iter = 20;
+
+  /// The GMRES iteration stops once the residual has been reduced by this
+  /// factor relative to the nonlinear residual; Newton then converges
+  /// linearly with at most this rate.
+  double krylov_rtol = 1e-4;
+
+  /// Size of the Krylov basis, GMRES restarts when it's full.
+  std::size_t krylov_dim = 20;
+  std::size_t max_restarts = 20;
+};
+
+/// Counts of the expensive parts of JFNK.
+struct JFNKStats {
+  std::size_t n_newton_iterations = 0;
+  std::size_t n_krylov_iterations = 0;
+  std::size_t n_rhs_evals = 0;
+};
+
+/// The part of JFNK which persists between steps: the statistics and the
+/// small dense GMRES arrays, such that steps don't allocate.
+struct JFNKCache {
+  std::size_t owner = 0;
+
+  // The Hessenberg matrix, column major with `krylov_dim + 1` rows; the
+  // Givens rotations; the rotated right hand side; and its solution.
+  std::vector<double> hessenberg;
+  std::vector<double> cs;
+  std::vector<double> sn;
+  std::vector<double> g;
+  std::vector<double> coefficients;
+
+  JFNKStats stats;
+};
+
+/// Solves `y - gamma_dt * f(y, t) = b` by Newton's method, with GMRES for the
+/// Newton corrections.
+///
+/// Uses the vector slots `0, ..., krylov_dim + 6` and the state slot 3 of the
+/// workspace; and state slot 4 for the preconditioner.
+class JFNKSolver {
+public:
+  /// `preconditioner` may be `nullptr`.
+  JFNKSolver(std::shared_ptr<RHS> rhs,
+             std::shared_ptr<const Preconditioner> preconditioner,
+             JFNKOptions options)
+      : rhs(std::move(rhs)),
+        preconditioner(std::move(preconditioner)),
+        options(options),
+        id(make_workspace_owner_id()) {
+    if (options.krylov_dim == 0) {
+      throw std::invalid_argument("JFNKSolver: `krylov_dim` is zero.");
+    }
+  }
+
+  /// On entry `y` is the initial guess, on exit the solution.
+  void solve(Span<double> y,
+             Span<const double> b,
+             double gamma_dt,
+             double t,
+             Workspace &workspace) const {
+    std::size_t n = y.size();
+    auto &c = cache(workspace);
+
+    // `-F(y) = b + gamma_dt * f(y, t) - y`, the right hand side of GMRES.
+    auto &minus_F = workspace.vector(0, n);
+    auto &delta = workspace.vector(1, n);
+    auto &f0 = workspace.vector(2, n);
+
+    if (preconditioner != nullptr) {
+      preconditioner->setup(y, t, gamma_dt, workspace);
+    }
+
+    for (int iter = 0; iter < options.max_newton_iter; ++iter) {
+      c.stats.n_newton_iterations += 1;
+
+      eval_rhs(f0, y, t, c);
+      for (std::size_t i = 0; i < n; ++i) {
+        minus_F[i] = b[i] + gamma_dt * f0[i] - y[i];
+      }
+
+      gmres(delta, minus_F, y, f0, gamma_dt, t, c, workspace);
+
+      double err = 0.0;
+      for (std::size_t i = 0; i < n; ++i) {
+        y[i] += delta[i];
+        double scale = options.atol + options.rtol * std::abs(y[i]);
+        err = std::max(err, std::abs(delta[i]) / scale);
+      }
+
+      if (err <= 1.0) {
+        return;
+      }
+    }
+
+    throw std::runtime_error("JFNKSolver: no convergence.");
+  }
+
+  /// The statistics of the trajectory computed with `workspace`.
+  const JFNKStats &stats(Workspace &workspace) const {
+    return cache(workspace).stats;
+  }
+
+private:
+  JFNKCache &cache(Workspace &workspace) const {
+    auto &c = workspace.state<JFNKCache>(3);
+    if (c.owner != id) {
+      c = JFNKCache{};
+      c.owner = id;
+    }
+    return c;
+  }
+
+  void eval_rhs(Span<double> dydt,
+                Span<const double> y,
+                double t,
+                JFNKCache &c) const {
+    (*rhs)(dydt, y, t);
+    c.stats.n_rhs_evals += 1;
+  }
+
+  static double dot(Span<const double> x, Span<const double> y) {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      sum += x[i] * y[i];
+    }
+    return sum;
+  }
+
+  // `Av = v - gamma_dt * J v`, with `J v` by a directional difference at
+  // `(y, t)` where `f(y, t) = f0`.
+  void apply_matrix(Span<double> Av,
+                    Span<const double> v,
+                    Span<const double> y,
+                    Span<const double> f0,
+                    double gamma_dt,
+                    double t,
+                    JFNKCache &c,
+                    Workspace &workspace) const {
+    std::size_t n = y.size();
+    double v_norm = std::sqrt(dot(v, v));
+    if (v_norm == 0.0) {
+      std::fill(Av.begin(), Av.end(), 0.0);
+      return;
+    }
+
+    // Balances truncation and rounding, see Knoll and Keyes, Eq. (14).
+    double y_norm = std::sqrt(dot(y, y));
+    double eps = std::sqrt(std::numeric_limits<double>::epsilon()
+                           * (1.0 + y_norm))
+                 / v_norm;
+
+    auto &y_pert = workspace.vector(3, n);
+    auto &f_pert = workspace.vector(4, n);
+    for (std::size_t i = 0; i < n; ++i) {
+      y_pert[i] = y[i] + eps * v[i];
+    }
+    eval_rhs(f_pert, y_pert, t, c);
+
+    double scale = gamma_dt / eps;
+    for (std::size_t i = 0; i < n; ++i) {
+      Av[i] = v[i] - scale * (f_pert[i] - f0[i]);
+    }
+  }
+
+  void apply_preconditioner(Span<double> z,
+                            Span<const double> r,
+                            Workspace &workspace) const {
+    if (preconditioner != nullptr) {
+      preconditioner->apply(z, r, workspace);
+    } else {
+      std::copy(r.begin(), r.end(), z.begin());
+    }
+  }
+
+  // Restarted GMRES with right preconditioning for `A x = rhs`, starting from
+  // `x = 0`.
+  void gmres(Span<double> x,
+             Span<const double> rhs,
+             Span<const double> y,
+             Span<const double> f0,
+             double gamma_dt,
+             double t,
+             JFNKCache &c,
+             Workspace &workspace) const {
+    std::size_t n = y.size();
+    std::size_t m = options.krylov_dim;
+
+    auto &r = workspace.vector(5, n);
+    auto basis = [&](std::size_t j) -> Span<double> {
+      return workspace.vector(6 + j, n);
+    };
+
+    c.hessenberg.resize((m + 1) * m);
+    c.cs.resize(m);
+    c.sn.resize(m);
+    c.g.resize(m + 1);
+    c.coefficients.resize(m);
+    auto H = [&](std::size_t i, std::size_t j) -> double & {
+      return c.hessenberg[j * (m + 1) + i];
+    };
+
+    std::fill(x.begin(), x.end(), 0.0);
+    std::copy(rhs.begin(), rhs.end(), r.begin());
+    double tol = options.krylov_rtol * std::sqrt(dot(rhs, rhs));
+
+    for (std::size_t restart = 0; restart <= options.max_restarts; ++restart) {
+      double beta = std::sqrt(dot(r, r));
+      if (beta <= tol || beta == 0.0) {
+        return;
+      }
+
+      auto v0 = basis(0);
+      for (std::size_t i = 0; i < n; ++i) {
+        v0[i] = r[i] / beta;
+      }
+      std::fill(c.g.begin(), c.g.end(), 0.0);
+      c.g[0] = beta;
+
+      // Arnoldi with modified Gram-Schmidt; `r` is the scratch pad for
+      // `M^-1 v_j`.
+      std::size_t k = 0;
+      while (k < m) {
+        c.stats.n_krylov_iterations += 1;
+
+        auto w = basis(k + 1);
+        apply_preconditioner(r, basis(k), workspace);
+        apply_matrix(w, r, y, f0, gamma_dt, t, c, workspace);
+
+        for (std::size_t i = 0; i <= k; ++i) {
+          auto v_i = basis(i);
+          double h = dot(w, v_i);
+          for (std::size_t l = 0; l < n; ++l) {
+            w[l] -= h * v_i[l];
+          }
+          H(i, k) = h;
+        }
+
+        double h_next = std::sqrt(dot(w, w));
+        H(k + 1, k) = h_next;
+        if (h_next != 0.0) {
+          for (std::size_t l = 0; l < n; ++l) {
+            w[l] /= h_next;
+          }
+        }
+
+        // Apply the previous rotations to the new column, then eliminate
+        // its subdiagonal entry.
+        for (std::size_t i = 0; i < k; ++i) {
+          double h_i = H(i, k);
+          H(i, k) = c.cs[i] * h_i + c.sn[i] * H(i + 1, k);
+          H(i + 1, k) = -c.sn[i] * h_i + c.cs[i] * H(i + 1, k);
+        }
+
+        double rho = std::hypot(H(k, k), H(k + 1, k));
+        c.cs[k] = H(k, k) / rho;
+        c.sn[k] = H(k + 1, k) / rho;
+        H(k, k) = rho;
+        H(k + 1, k) = 0.0;
+
+        c.g[k + 1] = -c.sn[k] * c.g[k];
+        c.g[k] = c.cs[k] * c.g[k];
+
+        k += 1;
+
+        // `|g[k]|` is the residual norm; a breakdown means it's exact.
+        if (std::abs(c.g[k]) <= tol || h_next == 0.0) {
+          break;
+        }
+      }
+
+      // Solve the triangular system, then `x += M^-1 (V y)`.
+      for (std::size_t i = k; i-- > 0;) {
+        double sum = c.g[i];
+        for (std::size_t j = i + 1; j < k; ++j) {
+          sum -= H(i, j) * c.coefficients[j];
+        }
+        c.coefficients[i] = sum / H(i, i);
+      }
+
+      auto &Vy = workspace.vector(3, n);
+      std::fill(Vy.begin(), Vy.end(), 0.0);
+      for (std::size_t j = 0; j < k; ++j) {
+        auto v_j = basis(j);
+        for (std::size_t l = 0; l < n; ++l) {
+          Vy[l] += c.coefficients[j] * v_j[l];
+        }
+      }
+      apply_preconditioner(r, Vy, workspace);
+      for (std::size_t l = 0; l < n; ++l) {
+        x[l] += r[l];
+      }
+
+      if (std::abs(c.g[k]) <= tol) {
+        return;
+      }
+
+      // The true residual, `rhs - A x`, to restart from.
+      auto Ax = basis(0);
+      apply_matrix(Ax, x, y, f0, gamma_dt, t, c, workspace);
+      for (std::size_t l = 0; l < n; ++l) {
+        r[l] = rhs[l] - Ax[l];
+      }
+    }
+
+    // Not converged; an inexact correction is still a correction. Newton
+    // decides whether it's good enough.
+  }
+
+  std::shared_ptr<RHS> rhs;
+  std::shared_ptr<const Preconditioner> preconditioner;
+  JFNKOptions options;
+  std::size_t id;
+};
+
+/// Backward Euler with the nonlinear system solved by JFNK.
+///
+/// Workspace, see `JFNKSolver`.
+class JFNKBackwardEulerStep : public RKStep {
+public:
+  explicit JFNKBackwardEulerStep(
+      std::shared_ptr<RHS> rhs,
+      std::shared_ptr<const Preconditioner> preconditioner = nullptr,
+      JFNKOptions options = JFNKOptions{})
+      : jfnk(std::move(rhs), std::move(preconditioner), options) {}
+
+  /// The JFNK statistics of the trajectory computed with `workspace`.
+  const JFNKStats &jfnk_stats(Workspace &workspace) const {
+    return jfnk.stats(workspace);
+  }
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+
+    std::copy(y0.begin(), y0.end(), y1.begin());
+    jfnk.solve(y1, y0, dt, t + dt, workspace);
+  }
+
+private:
+  JFNKSolver jfnk;
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+// A classic RK4 keeps four stages next to `y0` and `y1`, that's six vectors
+// the size of the state. With 10^9 unknowns that's 48 GB. Low-storage schemes
+// in the form of Williamson need only two registers, the state `y` and one
+// increment `dq`:
+//
+//   for s = 1, ..., S:
+//     dq = A[s] * dq + dt * f(y, t + c[s] * dt)
+//     y  = y + B[s] * dq
+//
+// The state is overwritten stage by stage, i.e. the step is naturally in
+// place. The price is one more stage than classic RK4 for fourth order.
+//
+// The update of `dq` is a fused `RHS::add_scaled`. If the RHS doesn't provide
+// it, `f` needs its own register, i.e. three instead of two. Either way, a
+// stage is two passes over memory: the RHS and the update of `y`.
+//
+// With a `float` state and a `double` increment, a stage moves 44 instead of
+// 56 bytes per unknown; at the price of rounding the state to `float` after
+// every stage.
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// The coefficients of a 2N-storage RK scheme in Williamson form.
+struct LowStorageTableau {
+  std::vector<double> A;
+  std::vector<double> B;
+  std::vector<double> c;
+
+  int order;
+};
+
+/// Williamson's three stage, third order scheme.
+inline LowStorageTableau williamson_rk3_tableau() {
+  return {{0.0, -5.0 / 9.0, -153.0 / 128.0},
+          {1.0 / 3.0, 15.0 / 16.0, 8.0 / 15.0},
+          {0.0, 1.0 / 3.0, 3.0 / 4.0},
+          3};
+}
+
+/// The five stage, fourth order scheme of Carpenter and Kennedy, RK4(3)5[2N].
+inline LowStorageTableau carpenter_kennedy_rk4_tableau() {
+  return {{0.0,
+           -567301805773.0 / 1357537059087.0,
+           -2404267990393.0 / 2016746695238.0,
+           -3550918686646.0 / 2091501179385.0,
+           -1275806237668.0 / 842570457699.0},
+          {1432997174477.0 / 9575080441755.0,
+           5161836677717.0 / 13612068292357.0,
+           1720146321549.0 / 2090206949498.0,
+           3134564353537.0 / 4481467310338.0,
+           2277821191437.0 / 14882151754819.0},
+          {0.0,
+           1432997174477.0 / 9575080441755.0,
+           2526269341429.0 / 6820363962896.0,
+           2006345519317.0 / 3224310063776.0,
+           2802321613138.0 / 2924317926251.0},
+          4};
+}
+
+/// One step of a 2N-storage RK scheme.
+///
+/// The state is stored as `Scalar`; the increment `dq` as `Accumulator`,
+/// which is also the precision of the RHS and of the arithmetic of the update.
+/// Hence, `BasicLowStorageRKStep<float, double>` keeps a single precision
+/// state, but accumulates the stages in double precision. The RHS is a
+/// `BasicRHS<double>`, which reads the `float` state through
+/// `RHS::add_scaled_widened`; then it's still two registers, `N` floats and
+/// `N` doubles. A RHS which doesn't provide it is evaluated on a `double` copy
+/// of the state, i.e. one more register and pass per stage.
+///
+/// Advances in place, using the slot 0 of the workspace for `dq`; slot 1 for
+/// `f` if the RHS can't fuse the update; and slot 2 for the copy of the state.
+template <class Scalar, class Accumulator = Scalar>
+class BasicLowStorageRKStep : public BasicRKStep<Scalar> {
+  static_assert(std::is_same_v<Scalar, Accumulator>
+                    || (std::is_same_v<Scalar, float>
+                        && std::is_same_v<Accumulator, double>),
+                "Either a single precision, or a float state with double "
+                "stages.");
+
+public:
+  BasicLowStorageRKStep(std::shared_ptr<BasicRHS<Accumulator>> rhs,
+                        LowStorageTableau tableau)
+      : rhs(std::move(rhs)), tableau(std::move(tableau)) {
+    auto n_stages = this->tableau.A.size();
+    if (n_stages == 0 || this->tableau.B.size() != n_stages
+        || this->tableau.c.size() != n_stages) {
+      throw std::invalid_argument("LowStorageRKStep: inconsistent tableau.");
+    }
+
+    // Otherwise `dq` from the previous step would leak into the first stage.
+    if (this->tableau.A[0] != 0.0) {
+      throw std::invalid_argument("LowStorageRKStep: `A[0]` must be zero.");
+    }
+  }
+
+  int order() const { return tableau.order; }
+
+protected:
+  void do_advance(Span<Scalar> y1,
+                  Span<const Scalar> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+
+    std::copy(y0.begin(), y0.end(), y1.begin());
+    do_advance_in_place(y1, t, dt, workspace);
+  }
+
+  bool do_advance_in_place(Span<Scalar> y,
+                           double t,
+                           double dt,
+                           Workspace &workspace) const override {
+    const auto &B = tableau.B;
+    const auto &c = tableau.c;
+    std::size_t n_stages = B.size();
+    std::size_t n = y.size();
+    auto &dq = workspace.vector<Accumulator>(0, n);
+
+    // The scaling of `dq` by `A[s + 1]` is fused into the update of stage `s`.
+    for (std::size_t s = 0; s < n_stages; ++s) {
+      double t_stage = t + c[s] * dt;
+
+      if constexpr (std::is_same_v<Scalar, Accumulator>) {
+        if (s == 0) {
+          // Since `A[0] == 0`, the first stage is `dq = dt * f`. The factor
+          // `dt` is applied in the update.
+          (*rhs)(dq, y, t_stage);
+          update(y, dq, B[0] * dt, next_A(0) * dt);
+          continue;
+        }
+
+        if (rhs->add_scaled(dq, dq, dt, y, t_stage)) {
+          update(y, dq, B[s], next_A(s));
+          continue;
+        }
+
+        auto &f = workspace.vector<Accumulator>(1, n);
+        (*rhs)(f, y, t_stage);
+        update(y, dq, f, dt, B[s], next_A(s));
+      } else {
+        if (s == 0) {
+          // Zero after the last stage, unless this is the first step.
+          std::fill(dq.begin(), dq.end(), Accumulator(0));
+        }
+
+        if (!rhs->add_scaled_widened(dq, dq, dt, y, t_stage)) {
+          auto &y_wide = workspace.vector<Accumulator>(2, n);
+          std::copy(y.begin(), y.end(), y_wide.begin());
+          if (!rhs->add_scaled(dq, dq, dt, y_wide, t_stage)) {
+            auto &f = workspace.vector<Accumulator>(1, n);
+            (*rhs)(f, y_wide, t_stage);
+            for (std::size_t i = 0; i < n; ++i) {
+              dq[i] += dt * f[i];
+            }
+          }
+        }
+
+        update(y, dq, B[s], next_A(s));
+      }
+    }
+
+    return true;
+  }
+
+private:
+  // `y += b * dq` followed by `dq *= a`, in one pass. The state is widened,
+  // updated and rounded element by element.
+  static void update(Span<Scalar> y, Span<Accumulator> dq, double b, double a) {
+    auto b_ = Accumulator(b);
+    auto a_ = Accumulator(a);
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      y[i] = Scalar(Accumulator(y[i]) + b_ * dq[i]);
+      dq[i] *= a_;
+    }
+  }
+
+  // Same as above, after `dq += dt * f`.
+  static void update(Span<Accumulator> y,
+                     Span<Accumulator> dq,
+                     Span<const Accumulator> f,
+                     double dt,
+                     double b,
+                     double a) {
+    auto dt_ = Accumulator(dt);
+    auto b_ = Accumulator(b);
+    auto a_ = Accumulator(a);
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      Accumulator dq_i = dq[i] + dt_ * f[i];
+      y[i] += b_ * dq_i;
+      dq[i] = a_ * dq_i;
+    }
+  }
+
+  // The coefficient `A` of the stage after `s`; zero after the last stage,
+  // i.e. `dq` isn't needed anymore.
+  double next_A(std::size_t s) const {
+    return s + 1 < tableau.A.size() ? tableau.A[s + 1] : 0.0;
+  }
+
+  std::shared_ptr<BasicRHS<Accumulator>> rhs;
+  LowStorageTableau tableau;
+};
+
+using LowStorageRKStep = BasicLowStorageRKStep<double>;
+
+/// Single precision state, double precision accumulation.
+using MixedPrecisionLowStorageRKStep = BasicLowStorageRKStep<float, double>;
@@ -0,0 +1,112 @@
+#pragma once
+
+// A RAII wrapper for a memory mapped file, see `raii/usecase_files.cpp` for
+// the pattern. POSIX only.
+//
+// Once mapped, reading and writing the file is reading and writing memory. The
+// operating system pages the data in and out as needed. Hence, the file can be
+// larger than RAM; and nothing is copied into intermediate buffers.
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class MappedFile {
+public:
+  /// Create (or truncate) `filename` to `size` bytes and map it read-write.
+  static MappedFile create(const std::string &filename, std::size_t size) {
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+      int error = errno;
+      throw_errno(error, "open " + filename);
+    }
+
+    if (::ftruncate(fd, off_t(size)) == -1) {
+      int error = errno;
+      ::close(fd);
+      throw_errno(error, "ftruncate " + filename);
+    }
+
+    return MappedFile(fd, size, PROT_READ | PROT_WRITE, filename);
+  }
+
+  /// Map all of the existing file `filename` read-only.
+  static MappedFile open_read_only(const std::string &filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+      int error = errno;
+      throw_errno(error, "open " + filename);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) == -1) {
+      int error = errno;
+      ::close(fd);
+      throw_errno(error, "fstat " + filename);
+    }
+
+    return MappedFile(fd, std::size_t(info.st_size), PROT_READ, filename);
+  }
+
+  ~MappedFile() { release(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) { (*this) = std::move(other); }
+
+  MappedFile &operator=(MappedFile &&other) {
+    if (this == &other) {
+      return *this;
+    }
+
+    release();
+    std::swap(ptr, other.ptr);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  void *data() { return ptr; }
+  const void *data() const { return ptr; }
+  std::size_t size() const { return size_; }
+
+private:
+  MappedFile(int fd, std::size_t size, int protection, const std::string &name)
+      : size_(size) {
+    if (size > 0) {
+      void *p = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        int error = errno;
+        ::close(fd);
+        throw_errno(error, "mmap " + name);
+      }
+      ptr = p;
+    }
+
+    // The mapping stays valid after closing the file descriptor.
+    ::close(fd);
+  }
+
+  void release() {
+    if (ptr != nullptr) {
+      ::munmap(ptr, size_);
+      ptr = nullptr;
+      size_ = 0;
+    }
+  }
+
+  // Note: `errno` must be read before calling anything else, e.g. `close` or
+  // even building the message might overwrite it.
+  [[noreturn]] static void throw_errno(int error, const std::string &what) {
+    throw std::system_error(error, std::generic_category(), what);
+  }
+
+  void *ptr = nullptr;
+  std::size_t size_ = 0;
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+// Multilevel Monte Carlo (Giles, "Multilevel Monte Carlo path simulation",
+// Operations Research 56, 2008), for the expectation of a quantity of
+// interest `P` of a solve with random initial conditions or parameters.
+//
+// Plain Monte Carlo at a step size `dt` small enough for the bias needs
+// `O(1 / rmse^2)` samples, each at the full cost of the finest step size. MLMC
+// instead writes the expectation at level `L`, with step size
+// `dt_L = dt_0 / 2^L`, as the telescoping sum
+//
+//   E[P_L] = E[P_0] + sum_{l = 1}^{L} E[P_l - P_{l - 1}].
+//
+// Both `P_l` and `P_{l - 1}` of one sample of `P_l - P_{l - 1}` are computed
+// from the same random inputs. Hence, its variance vanishes as `dt` decreases:
+// most samples are spent on the cheap coarse levels, and only a few on the
+// fine ones. The number of samples per level is chosen from the observed
+// variances to minimize the cost for a given RMSE.
+//
+// The coupling is free with the counter-based streams of `monte_carlo.hpp`: a
+// copy of a `RandomStream` draws the same numbers again.
+//
+// The cost of a sample is modelled as its number of steps, not measured, such
+// that the number of samples per level, and hence the result, is reproducible
+// on any number of threads.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "monte_carlo.hpp"
+#include "thread_pool.hpp"
+
+/// Parameters of `mlmc`.
+struct MLMCOptions {
+  std::uint64_t seed = 0;
+
+  /// Samples of a level when it's added, to estimate its variance.
+  std::size_t n_initial_samples = 256;
+
+  /// The levels `0, ..., min_levels - 1` are always used. The bias is
+  /// estimated from the two finest levels, i.e. at least two are needed.
+  std::size_t min_levels = 3;
+  std::size_t max_levels = 16;
+
+  /// The order of the weak error in `dt`, e.g. 1 for Forward Euler; used to
+  /// estimate the remaining bias.
+  double weak_order = 1.0;
+
+  /// Chunk size of `monte_carlo`.
+  std::size_t chunk_size = 256;
+};
+
+/// Estimate of `E[P]` and what it cost.
+struct MLMCResult {
+  double estimate = 0.0;
+
+  /// The variance of the estimator, i.e. `sum_l V_l / N_l`.
+  double variance = 0.0;
+
+  /// The estimated bias `E[P_L] - E[P]`, from the finest levels.
+  double bias = 0.0;
+
+  /// The statistics of `P_l - P_{l - 1}`, or of `P_0` on level 0.
+  std::vector<SampleStats> levels;
+
+  /// Steps per sample of each level, i.e. of both solves.
+  std::vector<double> level_cost;
+
+  /// Total number of steps.
+  double cost = 0.0;
+
+  /// Steps plain Monte Carlo needs for the same variance at the finest step
+  /// size, using `V[P_0]` for `V[P_L]`.
+  double mc_cost = 0.0;
+
+  double rmse() const { return std::sqrt(variance + bias * bias); }
+};
+
+/// The expectation of `solve(rng, dt, thread_id)` to within `rmse`.
+///
+/// `solve` draws the random inputs of one sample from `rng`, solves from
+/// `t = 0` to `T` with steps of size `dt` and returns the quantity of interest.
+/// It must draw the same numbers for every `dt`. The step sizes are
+/// `dt_0 / 2^l`, with `T / dt_0` a power of two such that `solve_ode` ends
+/// exactly at `T`. The samples run on `pool`, see `monte_carlo`.
+template <class Solve>
+MLMCResult mlmc(const Solve &solve,
+                double T,
+                double dt_0,
+                double rmse,
+                ThreadPool &pool,
+                const MLMCOptions &options) {
+  if (!(rmse > 0.0)) {
+    throw std::invalid_argument("mlmc: `rmse` must be positive.");
+  }
+
+  if (options.min_levels < 2 || options.max_levels < options.min_levels) {
+    throw std::invalid_argument("mlmc: invalid number of levels.");
+  }
+
+  auto dt = [dt_0](std::size_t l) { return std::ldexp(dt_0, -int(l)); };
+  auto n_steps = [&](std::size_t l) { return std::ceil(T / dt(l)); };
+
+  auto result = MLMCResult{};
+  auto &levels = result.levels;
+  auto &cost = result.level_cost;
+  auto n_new = std::vector<std::size_t>{};
+
+  auto add_level = [&]() {
+    std::size_t l = levels.size();
+    levels.emplace_back();
+    cost.push_back(n_steps(l) + (l == 0 ? 0.0 : n_steps(l - 1)));
+    n_new.push_back(options.n_initial_samples);
+  };
+
+  for (std::size_t l = 0; l < options.min_levels; ++l) {
+    add_level();
+  }
+
+  // The remaining bias, from the corrections of the two finest levels. They
+  // decay like `dt^weak_order`.
+  double refinement = std::pow(2.0, options.weak_order);
+  auto bias = [&]() {
+    std::size_t L = levels.size() - 1;
+    return std::max(std::abs(levels[L - 1].mean) / refinement,
+                    std::abs(levels[L].mean));
+  };
+
+  auto mc_options = MonteCarloOptions{};
+  mc_options.seed = options.seed;
+  mc_options.chunk_size = options.chunk_size;
+  auto mc_stats = MonteCarloStats{};
+
+  while (true) {
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+      if (n_new[l] == 0) {
+        continue;
+      }
+
+      auto sample = [&](std::size_t /* index */,
+                        RandomStream &rng,
+                        std::size_t thread_id) {
+        // The coarse solve sees the same random numbers as the fine one.
+        auto rng_coarse = rng;
+        double fine = solve(rng, dt(l), thread_id);
+        if (l == 0) {
+          return fine;
+        }
+
+        return fine - solve(rng_coarse, dt(l - 1), thread_id);
+      };
+
+      // Every level has its own range of streams.
+      mc_options.first_sample = (std::uint64_t(l) << 40) + levels[l].count;
+      levels[l].merge(
+          monte_carlo(n_new[l], sample, pool, mc_options, mc_stats));
+      n_new[l] = 0;
+    }
+
+    // The optimal number of samples of level `l` is proportional to
+    // `sqrt(V_l / C_l)`, see Giles (2008), Eq. (6); the factor is chosen such
+    // that the variance of the estimator is `rmse^2 / 2`.
+    double sum_sqrt_vc = 0.0;
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+      sum_sqrt_vc += std::sqrt(levels[l].variance() * cost[l]);
+    }
+
+    bool is_done = true;
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+      double n_optimal = std::ceil(2.0 / (rmse * rmse)
+                                   * std::sqrt(levels[l].variance() / cost[l])
+                                   * sum_sqrt_vc);
+
+      auto n = std::size_t(n_optimal);
+      if (n > levels[l].count) {
+        n_new[l] = n - levels[l].count;
+
+        // Ignore negligible top-ups, as Giles does.
+        is_done &= double(n_new[l]) <= 0.01 * double(levels[l].count);
+      }
+    }
+
+    if (!is_done) {
+      continue;
+    }
+
+    // The other half of the squared error is the bias.
+    if (bias() <= (refinement - 1.0) * rmse / std::sqrt(2.0)
+        || levels.size() == options.max_levels) {
+      break;
+    }
+
+    std::fill(n_new.begin(), n_new.end(), 0);
+    add_level();
+  }
+
+  for (std::size_t l = 0; l < levels.size(); ++l) {
+    result.estimate += levels[l].mean;
+    result.variance += levels[l].variance() / double(levels[l].count);
+    result.cost += double(levels[l].count) * cost[l];
+  }
+  result.bias = bias() / (refinement - 1.0);
+
+  // Plain Monte Carlo with the same variance, all at the finest level.
+  double n_mc = levels[0].variance() / result.variance;
+  result.mc_cost = n_mc * n_steps(levels.size() - 1);
+
+  return result;
+}
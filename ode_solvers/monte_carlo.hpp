@@ -0,0 +1,301 @@
+#pragma once
+
+// Monte Carlo over initial conditions and parameters, reproducible bit for bit
+// on any number of threads. Three things would break that:
+//
+//   - A shared RNG, or one RNG per thread: which numbers a sample gets then
+//     depends on which thread ran it and when. Instead every sample has its own
+//     stream of a counter-based RNG, Philox4x32-10. The numbers are a pure
+//     function of `(seed, sample index, draw)`, and any sample can be
+//     generated without generating the ones before it.
+//
+//   - Scheduling: the samples are grouped into chunks of fixed size, which
+//     don't depend on the number of threads. Threads start with contiguous
+//     ranges of chunks and steal from the back of other threads' ranges once
+//     their own is exhausted. Which thread runs a chunk varies, what the chunk
+//     computes doesn't.
+//
+//   - Reduction: floating point addition isn't associative. Every chunk
+//     accumulates its samples in index order; then the chunks are combined in
+//     chunk order, after all threads are done.
+//
+// Requires that a sample only depends on its index and its stream, e.g. not
+// on the thread it runs on, and that the SIMD level doesn't change.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+/// The counter-based RNG Philox4x32-10 of Salmon et al., "Parallel random
+/// numbers: as easy as 1, 2, 3", SC11.
+///
+/// Maps a 128-bit counter and a 64-bit key to 128 random bits.
+struct Philox4x32 {
+  using Counter = std::array<std::uint32_t, 4>;
+  using Key = std::array<std::uint32_t, 2>;
+
+  static Counter generate(Counter counter, Key key) {
+    for (int round = 0; round < 10; ++round) {
+      std::uint64_t p0 = std::uint64_t(0xD2511F53) * counter[0];
+      std::uint64_t p1 = std::uint64_t(0xCD9E8D57) * counter[2];
+
+      counter = Counter{std::uint32_t(p1 >> 32) ^ counter[1] ^ key[0],
+                        std::uint32_t(p1),
+                        std::uint32_t(p0 >> 32) ^ counter[3] ^ key[1],
+                        std::uint32_t(p0)};
+
+      key[0] += 0x9E3779B9;
+      key[1] += 0xBB67AE85;
+    }
+
+    return counter;
+  }
+};
+
+/// The random numbers of one sample: stream `stream` of seed `seed`.
+///
+/// Cheap to create, e.g. one per sample.
+class RandomStream {
+public:
+  RandomStream(std::uint64_t seed, std::uint64_t stream)
+      : key{std::uint32_t(seed), std::uint32_t(seed >> 32)},
+        stream{std::uint32_t(stream), std::uint32_t(stream >> 32)} {}
+
+  /// Uniformly distributed in `[0, 1)`, with 53 random bits.
+  double uniform() {
+    if (n_buffered == 0) {
+      // The counter is the block number, followed by the stream.
+      auto counter = Philox4x32::Counter{std::uint32_t(n_blocks),
+                                         std::uint32_t(n_blocks >> 32),
+                                         stream[0],
+                                         stream[1]};
+      auto bits = Philox4x32::generate(counter, key);
+      n_blocks += 1;
+
+      buffer[0] = to_double(bits[0], bits[1]);
+      buffer[1] = to_double(bits[2], bits[3]);
+      n_buffered = 2;
+    }
+
+    n_buffered -= 1;
+    return buffer[1 - n_buffered];
+  }
+
+  /// Uniformly distributed in `[a, b)`.
+  double uniform(double a, double b) { return a + (b - a) * uniform(); }
+
+  /// Standard normal, by Box-Muller.
+  double normal() {
+    // `1 - u` is in `(0, 1]`, i.e. the logarithm is finite.
+    double r = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+    double phi = 2.0 * pi * uniform();
+    return r * std::cos(phi);
+  }
+
+private:
+  static constexpr double pi = 3.14159265358979323846;
+
+  static double to_double(std::uint32_t lo, std::uint32_t hi) {
+    std::uint64_t bits = (std::uint64_t(hi) << 32 | lo) >> 11;
+    return double(bits) * 0x1.0p-53;
+  }
+
+  Philox4x32::Key key;
+  std::array<std::uint32_t, 2> stream;
+  std::uint64_t n_blocks = 0;
+
+  std::array<double, 2> buffer = {};
+  int n_buffered = 0;
+};
+
+/// Mean, variance and maximum of a set of samples.
+struct SampleStats {
+  std::size_t count = 0;
+  double mean = 0.0;
+  double max = -std::numeric_limits<double>::infinity();
+
+  // Sum of squared deviations from the mean.
+  double m2 = 0.0;
+
+  /// Add a sample, by Welford's update.
+  void add(double x) {
+    count += 1;
+    double delta = x - mean;
+    mean += delta / double(count);
+    m2 += delta * (x - mean);
+    max = std::max(max, x);
+  }
+
+  /// Add all samples of `other`, by the update of Chan et al.
+  void merge(const SampleStats &other) {
+    if (other.count == 0) {
+      return;
+    }
+
+    if (count == 0) {
+      *this = other;
+      return;
+    }
+
+    auto n = double(count + other.count);
+    double delta = other.mean - mean;
+    mean += delta * double(other.count) / n;
+    m2 += other.m2 + delta * delta * double(count) * double(other.count) / n;
+    count += other.count;
+    max = std::max(max, other.max);
+  }
+
+  /// The unbiased sample variance.
+  double variance() const {
+    return count > 1 ? m2 / double(count - 1) : 0.0;
+  }
+};
+
+/// Parameters of `monte_carlo`.
+struct MonteCarloOptions {
+  std::uint64_t seed = 0;
+
+  /// The samples are `first_sample, ..., first_sample + n_samples - 1`, e.g.
+  /// to add samples to an earlier run without reusing its streams.
+  std::uint64_t first_sample = 0;
+
+  /// Samples per chunk. Part of the definition of the result: changing it
+  /// changes the order of the reduction, and hence the last bits.
+  std::size_t chunk_size = 256;
+};
+
+/// How the work was distributed.
+struct MonteCarloStats {
+  std::size_t n_chunks = 0;
+
+  /// Chunks run by a thread other than the one they were assigned to.
+  std::size_t n_stolen = 0;
+
+  double seconds = 0.0;
+};
+
+/// Statistics of `sample(index, rng, thread_id)` over `n_samples` samples.
+///
+/// `sample` returns the quantity of interest, e.g. the error of a solve, for
+/// the sample `index` drawing its random numbers from `rng`. It's called
+/// concurrently on the threads of `pool`; `thread_id` identifies the calling
+/// thread, e.g. to select a `SolverContext`, but the result must not depend
+/// on it. Exceptions are rethrown after all threads are done.
+template <class Sample>
+SampleStats monte_carlo(std::size_t n_samples,
+                        const Sample &sample,
+                        ThreadPool &pool,
+                        const MonteCarloOptions &options,
+                        MonteCarloStats &stats) {
+  using clock = std::chrono::steady_clock;
+  auto t_start = clock::now();
+
+  std::size_t chunk_size = options.chunk_size;
+  if (chunk_size == 0) {
+    throw std::invalid_argument("monte_carlo: `chunk_size` is zero.");
+  }
+
+  std::size_t n_chunks = (n_samples + chunk_size - 1) / chunk_size;
+  std::size_t n_threads = pool.n_threads();
+
+  // The chunks `[begin, end)` not yet started by anyone. The owner takes
+  // from the front, thieves take from the back.
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+  };
+
+  auto queues = std::vector<Queue>(n_threads);
+  for (std::size_t i = 0; i < n_threads; ++i) {
+    queues[i].begin = i * n_chunks / n_threads;
+    queues[i].end = (i + 1) * n_chunks / n_threads;
+  }
+
+  auto chunk_stats = std::vector<SampleStats>(n_chunks);
+  auto errors = std::vector<std::exception_ptr>(n_chunks);
+  auto n_stolen = std::vector<std::size_t>(n_threads, 0);
+
+  auto run_chunk = [&](std::size_t chunk, std::size_t thread_id) {
+    std::size_t first = chunk * chunk_size;
+    std::size_t last = std::min(first + chunk_size, n_samples);
+
+    try {
+      auto &s = chunk_stats[chunk];
+      for (std::size_t i = first; i < last; ++i) {
+        auto index = options.first_sample + i;
+        auto rng = RandomStream(options.seed, index);
+        s.add(sample(index, rng, thread_id));
+      }
+    } catch (...) {
+      errors[chunk] = std::current_exception();
+    }
+  };
+
+  pool.run([&](std::size_t thread_id) {
+    auto &own = queues[thread_id];
+    while (true) {
+      std::size_t chunk;
+      {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin == own.end) {
+          break;
+        }
+        chunk = own.begin++;
+      }
+      run_chunk(chunk, thread_id);
+    }
+
+    // Chunks don't reappear, hence a sweep finding all queues empty means
+    // we're done.
+    bool found = true;
+    while (found) {
+      found = false;
+      for (std::size_t k = 1; k < n_threads; ++k) {
+        auto &victim = queues[(thread_id + k) % n_threads];
+
+        std::size_t chunk;
+        {
+          std::lock_guard<std::mutex> lock(victim.mutex);
+          if (victim.begin == victim.end) {
+            continue;
+          }
+          chunk = --victim.end;
+        }
+
+        n_stolen[thread_id] += 1;
+        run_chunk(chunk, thread_id);
+        found = true;
+      }
+    }
+  });
+
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  auto result = SampleStats{};
+  for (const auto &s : chunk_stats) {
+    result.merge(s);
+  }
+
+  stats.n_chunks += n_chunks;
+  for (std::size_t n : n_stolen) {
+    stats.n_stolen += n;
+  }
+  stats.seconds
+      += std::chrono::duration<double>(clock::now() - t_start).count();
+
+  return result;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+// The runtime configurable front end. A config file names a scheme and a RHS;
+// the factory returns an `ODESolver`. For combinations which have been
+// instantiated at compile time it returns a static kernel, i.e. the only
+// virtual call is the one to `solve`. Everything else falls back to the
+// virtual `RKStep` and `RHS` hierarchy.
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "butcher_tableau.hpp"
+#include "dormand_prince.hpp"
+#include "exponential.hpp"
+#include "implicit.hpp"
+#include "low_storage_rk.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "static_dispatch.hpp"
+
+/// Interface of something that can solve an ODE.
+class ODESolver {
+public:
+  virtual ~ODESolver() = default;
+
+  /// Integrate from `t = 0` to `T` with steps of size `dt`.
+  virtual std::vector<double>
+  solve(std::vector<double> y0, double T, double dt) const = 0;
+
+  /// Are the step and the RHS resolved at compile time?
+  virtual bool is_static() const = 0;
+};
+
+/// Solver which dispatches every step and every RHS at runtime.
+class DynamicODESolver : public ODESolver {
+public:
+  explicit DynamicODESolver(std::shared_ptr<RKStep> rk_step)
+      : rk_step(std::move(rk_step)) {}
+
+  std::vector<double>
+  solve(std::vector<double> y0, double T, double dt) const override {
+    return solve_ode(*rk_step, std::move(y0), T, dt);
+  }
+
+  bool is_static() const override { return false; }
+
+private:
+  std::shared_ptr<RKStep> rk_step;
+};
+
+/// Solver for which the step and RHS are resolved at compile time.
+template <class Step>
+class StaticODESolver : public ODESolver {
+public:
+  explicit StaticODESolver(Step step = Step{}) : step(std::move(step)) {}
+
+  std::vector<double>
+  solve(std::vector<double> y0, double T, double dt) const override {
+    return solve_ode_static(step, std::move(y0), T, dt);
+  }
+
+  bool is_static() const override { return true; }
+
+private:
+  Step step;
+};
+
+/// Factory for the runtime polymorphic steps.
+inline std::shared_ptr<RKStep> make_rk_step(const std::string &scheme,
+                                            std::shared_ptr<RHS> rhs) {
+  if (scheme == "forward_euler") {
+    return std::make_shared<ForwardEulerStep>(std::move(rhs));
+  }
+
+  if (scheme == "dormand_prince") {
+    return std::make_shared<DormandPrinceStep>(std::move(rhs));
+  }
+
+  if (scheme == "heun") {
+    return std::make_shared<HeunStep>(std::move(rhs));
+  }
+
+  if (scheme == "ssp_rk3") {
+    return std::make_shared<SSPRK3Step>(std::move(rhs));
+  }
+
+  if (scheme == "rk4") {
+    return std::make_shared<RK4Step>(std::move(rhs));
+  }
+
+  if (scheme == "rk38") {
+    return std::make_shared<RK38Step>(std::move(rhs));
+  }
+
+  if (scheme == "williamson_rk3") {
+    return std::make_shared<LowStorageRKStep>(std::move(rhs),
+                                              williamson_rk3_tableau());
+  }
+
+  if (scheme == "carpenter_kennedy_rk4") {
+    return std::make_shared<LowStorageRKStep>(std::move(rhs),
+                                              carpenter_kennedy_rk4_tableau());
+  }
+
+  if (scheme == "exponential_euler") {
+    return std::make_shared<ExponentialEulerStep>(std::move(rhs));
+  }
+
+  if (scheme == "etdrk2") {
+    return std::make_shared<ETDRK2Step>(std::move(rhs));
+  }
+
+  if (scheme == "backward_euler") {
+    return std::make_shared<BackwardEulerStep>(std::move(rhs));
+  }
+
+  if (scheme == "bdf") {
+    return std::make_shared<BDFStep>(std::move(rhs));
+  }
+
+  throw std::invalid_argument("Unknown scheme: " + scheme);
+}
+
+/// Factory which prefers pre-instantiated static kernels.
+///
+/// The only one is Forward Euler for `exp`; every other combination is the
+/// virtual `RKStep` from `make_rk_step`. Check `ODESolver::is_static` to see
+/// which one was picked.
+inline std::shared_ptr<ODESolver> make_ode_solver(const std::string &scheme,
+                                                  const std::string &rhs_name) {
+  if (scheme == "forward_euler" && rhs_name == "exp") {
+    return std::make_shared<
+        StaticODESolver<StaticForwardEulerStep<ExpKernel>>>();
+  }
+
+  auto rhs = make_rhs(rhs_name);
+  return std::make_shared<DynamicODESolver>(
+      make_rk_step(scheme, std::move(rhs)));
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+// Parallel in time. If the state is small, e.g. the three variables of
+// `ic()`, there's nothing to split between threads in space. Parareal splits
+// `[0, T]` into time slices instead. With a cheap coarse step `G` and an
+// accurate fine step `F` it iterates
+//
+//   U[n + 1] <- G(U_new[n]) + F(U[n]) - G(U[n])
+//
+// where `U[n]` is the state at the start of slice `n`. The fine propagations
+// of all slices are independent and run concurrently; only the cheap coarse
+// sweep is sequential. After `k` iterations the first `k` slices agree with
+// the serial fine solution exactly, hence it terminates after at most
+// `n_slices` iterations. It pays off if it converges in far fewer.
+//
+// The speedup is bounded by `n_slices / n_iterations`, and by the ratio of the
+// cost of `F` and `G`.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <time.h>
+
+#include "rk_step.hpp"
+#include "thread_pool.hpp"
+#include "workspace.hpp"
+
+/// Parameters of Parareal.
+struct PararealOptions {
+  /// Number of time slices, typically a multiple of the number of threads.
+  std::size_t n_slices = 16;
+
+  /// At most `n_slices` iterations are ever needed.
+  std::size_t max_iterations = 16;
+
+  /// Converged if no state at a slice boundary changes by more than
+  /// `atol + rtol * |y|`.
+  double atol = 1e-10;
+  double rtol = 1e-10;
+};
+
+/// What it took to converge.
+struct PararealStats {
+  std::size_t n_iterations = 0;
+  bool is_converged = false;
+
+  /// Wall time spent in the parallel fine and the sequential coarse
+  /// propagations; and in total.
+  double fine_seconds = 0.0;
+  double coarse_seconds = 0.0;
+  double seconds = 0.0;
+
+  /// The time a serial fine solve would take, i.e. the sum of the CPU times
+  /// of the fine propagations of all slices in the first iteration. It's CPU
+  /// time, such that it's meaningful even if there are more threads than
+  /// cores.
+  double serial_seconds = 0.0;
+
+  double speedup() const { return serial_seconds / seconds; }
+};
+
+/// CPU time of the calling thread, in seconds. POSIX only.
+inline double thread_cpu_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return double(ts.tv_sec) + 1e-9 * double(ts.tv_nsec);
+}
+
+/// Advance `y` from `t0` to `t1` in steps of size at most `dt`.
+///
+/// The steps are shortened slightly such that they end exactly at `t1`.
+inline void propagate(const RKStep &rk_step,
+                      std::vector<double> &y,
+                      std::vector<double> &buffer,
+                      double t0,
+                      double t1,
+                      double dt,
+                      Workspace &workspace) {
+  auto n_steps = std::max(std::size_t(std::ceil((t1 - t0) / dt - 1e-10)),
+                          std::size_t(1));
+  double h = (t1 - t0) / double(n_steps);
+
+  buffer.resize(y.size());
+  for (std::size_t step = 0; step < n_steps; ++step) {
+    double t = t0 + double(step) * h;
+    if (!rk_step.advance_in_place(y, t, h, workspace)) {
+      rk_step.advance(buffer, y, t, h, workspace);
+      std::swap(y, buffer);
+    }
+  }
+}
+
+/// Integrate from `t = 0` to `T` by Parareal.
+///
+/// `coarse` with steps of size `dt_coarse` is the predictor, `fine` with
+/// steps of size `dt_fine` the accurate solver. The fine propagations run on
+/// the threads of `pool`, each with its `thread_local_workspace()`.
+///
+/// Returns the state at `T`; if it converged, it agrees with the serial fine
+/// solution up to the tolerance.
+inline std::vector<double> solve_ode_parareal(const RKStep &coarse,
+                                              double dt_coarse,
+                                              const RKStep &fine,
+                                              double dt_fine,
+                                              std::vector<double> y0,
+                                              double T,
+                                              ThreadPool &pool,
+                                              const PararealOptions &options,
+                                              PararealStats &stats) {
+  using clock = std::chrono::steady_clock;
+  auto seconds_since = [](clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  };
+
+  std::size_t n_slices = options.n_slices;
+  if (n_slices == 0) {
+    throw std::invalid_argument("solve_ode_parareal: no time slices.");
+  }
+
+  auto t_start = clock::now();
+  auto slice_begin = [&](std::size_t n) { return T * double(n) / n_slices; };
+
+  // `U[n]` is the state at the start of slice `n`, `U[n_slices]` at `T`.
+  // `G[n]` and `F[n]` are the coarse and fine propagations of `U[n]`.
+  auto U = std::vector<std::vector<double>>(n_slices + 1, y0);
+  auto G = std::vector<std::vector<double>>(n_slices, y0);
+  auto F = std::vector<std::vector<double>>(n_slices, y0);
+  auto fine_buffers = std::vector<std::vector<double>>(n_slices);
+  auto slice_seconds = std::vector<double>(n_slices, 0.0);
+  auto errors = std::vector<std::exception_ptr>(n_slices);
+
+  auto &workspace = thread_local_workspace();
+  std::vector<double> coarse_buffer;
+
+  // The initial guess, a serial coarse solve.
+  auto t_coarse = clock::now();
+  for (std::size_t n = 0; n < n_slices; ++n) {
+    G[n] = U[n];
+    propagate(coarse,
+              G[n],
+              coarse_buffer,
+              slice_begin(n),
+              slice_begin(n + 1),
+              dt_coarse,
+              workspace);
+    U[n + 1] = G[n];
+  }
+  stats.coarse_seconds += seconds_since(t_coarse);
+
+  std::vector<double> G_new;
+  std::size_t max_iterations = std::min(options.max_iterations, n_slices);
+  for (std::size_t k = 0; k < max_iterations; ++k) {
+    // Slices `0, ..., k - 1` are exact; the fine propagation of slice `k - 1`
+    // has already been used to get `U[k]`.
+    auto t_fine = clock::now();
+    pool.run([&](std::size_t thread_id) {
+      auto &thread_workspace = thread_local_workspace();
+      for (std::size_t n = k + thread_id; n < n_slices;
+           n += pool.n_threads()) {
+        double t_slice = thread_cpu_seconds();
+        try {
+          F[n] = U[n];
+          propagate(fine,
+                    F[n],
+                    fine_buffers[n],
+                    slice_begin(n),
+                    slice_begin(n + 1),
+                    dt_fine,
+                    thread_workspace);
+        } catch (...) {
+          errors[n] = std::current_exception();
+        }
+        slice_seconds[n] = thread_cpu_seconds() - t_slice;
+      }
+    });
+    stats.fine_seconds += seconds_since(t_fine);
+
+    for (const auto &error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    if (k == 0) {
+      for (double s : slice_seconds) {
+        stats.serial_seconds += s;
+      }
+    }
+
+    // The sequential correction sweep.
+    t_coarse = clock::now();
+    double max_change = 0.0;
+    U[k + 1] = F[k];
+    for (std::size_t n = k + 1; n < n_slices; ++n) {
+      G_new = U[n];
+      propagate(coarse,
+                G_new,
+                coarse_buffer,
+                slice_begin(n),
+                slice_begin(n + 1),
+                dt_coarse,
+                workspace);
+
+      auto &y = U[n + 1];
+      for (std::size_t i = 0; i < y.size(); ++i) {
+        double y_new = G_new[i] + F[n][i] - G[n][i];
+        double scale = options.atol + options.rtol * std::abs(y_new);
+        max_change = std::max(max_change, std::abs(y_new - y[i]) / scale);
+        y[i] = y_new;
+      }
+      std::swap(G[n], G_new);
+    }
+    stats.coarse_seconds += seconds_since(t_coarse);
+
+    stats.n_iterations = k + 1;
+    if (max_change <= 1.0) {
+      stats.is_converged = true;
+      break;
+    }
+  }
+
+  // After `n_slices` iterations every slice is exact.
+  stats.is_converged |= stats.n_iterations == n_slices;
+  stats.seconds = seconds_since(t_start);
+
+  return U[n_slices];
+}
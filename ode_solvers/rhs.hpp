@@ -0,0 +1,393 @@
+#pragma once
+
+// The ODE machinery from `polymorphism/usecase_odes.cpp` split into headers so
+// that several programs can share it. The tutorial explains the design; the
+// headers in this directory are about making it fast.
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "dense_matrix.hpp"
+#include "instrumentation.hpp"
+#include "simd.hpp"
+#include "span.hpp"
+
+/// How a block of `n_states` states with `n_vars` variables each is stored.
+enum class BatchLayout {
+  /// State innermost, i.e. variable `i` of state `k` is `[k * n_vars + i]`.
+  /// The states are consecutive, like rows of a matrix.
+  state_major,
+
+  /// Variable innermost, i.e. variable `i` of state `k` is
+  /// `[i * n_states + k]`. This is the layout of `ensemble.hpp`.
+  variable_major
+};
+
+/// Interface of a RHS, for states which are contiguous arrays of `Scalar`.
+///
+/// The state is passed as a `Span`, any `std::vector<Scalar>` converts to one
+/// implicitly, see `span.hpp`.
+///
+/// The public methods aren't virtual, implementations override the protected
+/// `do_*` methods. See `instrumentation.hpp` for why.
+///
+/// Whatever the precision of the state, time and the Jacobian are always
+/// `double`.
+template <class Scalar>
+class BasicRHS {
+public:
+  virtual ~BasicRHS() = default;
+
+  /// Store the rate of change at `(y, t)` in `dydt`.
+  void operator()(Span<Scalar> dydt, Span<const Scalar> y, double t) const {
+    auto scope = instrument(*this, "eval", 2 * y.size() * sizeof(Scalar));
+    do_eval(dydt, y, t);
+  }
+
+  /// Store the rate of change of `n_states` states at the same `t`.
+  ///
+  /// Both `y` and `dydt` hold `n_states` states of `y.size() / n_states`
+  /// variables each, stored as `layout` says. Ensembles, finite difference
+  /// Jacobians and the like need f at many states; this is one virtual call
+  /// for all of them, instead of one per state. The default loops over the
+  /// states, a RHS which can do better, e.g. vectorize across the states,
+  /// overrides `do_eval_batch`.
+  void eval_batch(Span<Scalar> dydt,
+                  Span<const Scalar> y,
+                  double t,
+                  std::size_t n_states,
+                  BatchLayout layout) const {
+    assert(dydt.size() == y.size());
+    assert(n_states == 0 || y.size() % n_states == 0);
+    auto scope
+        = instrument(*this, "eval_batch", 2 * y.size() * sizeof(Scalar));
+    do_eval_batch(dydt, y, t, n_states, layout);
+  }
+
+  /// Optionally, compute `out = base + alpha * f(y, t)` in a single pass.
+  ///
+  /// Computing f(y, t) first means writing all of `dydt` only to read it back
+  /// immediately; that's five passes over memory per Forward Euler step
+  /// instead of three. If a RHS doesn't provide the fused version, it returns
+  /// `false` without touching `out`; the caller must then fall back to
+  /// `operator()`.
+  ///
+  /// Note: `out` may be the same memory as `base`, but not as `y`.
+  bool add_scaled(Span<Scalar> out,
+                  Span<const Scalar> base,
+                  double alpha,
+                  Span<const Scalar> y,
+                  double t) const {
+    auto scope
+        = instrument(*this, "add_scaled", 3 * y.size() * sizeof(Scalar));
+    bool is_fused = do_add_scaled(out, base, alpha, y, t);
+    if (!is_fused) {
+      scope.discard();
+    }
+    return is_fused;
+  }
+
+  /// Optionally, the same as `add_scaled` for a single precision `y`, which is
+  /// widened to `Scalar` element by element.
+  ///
+  /// This is what lets a mixed precision step keep its state in `float`
+  /// without a `double` copy of it, see `low_storage_rk.hpp`. If a RHS doesn't
+  /// provide it, it returns `false` without touching `out`.
+  bool add_scaled_widened(Span<Scalar> out,
+                          Span<const Scalar> base,
+                          double alpha,
+                          Span<const float> y,
+                          double t) const {
+    std::size_t bytes = y.size() * (sizeof(float) + 2 * sizeof(Scalar));
+    auto scope = instrument(*this, "add_scaled_widened", bytes);
+    bool is_fused = do_add_scaled_widened(out, base, alpha, y, t);
+    if (!is_fused) {
+      scope.discard();
+    }
+    return is_fused;
+  }
+
+  /// Optionally, store the Jacobian `df/dy` at `(y, t)` in `dfdy`.
+  ///
+  /// Returns `false` if the RHS doesn't know its Jacobian; implicit steps
+  /// then approximate it by finite differences.
+  bool jacobian(DenseMatrix &dfdy, Span<const Scalar> y, double t) const {
+    std::size_t n = y.size();
+    std::size_t bytes = n * n * sizeof(double) + n * sizeof(Scalar);
+    auto scope = instrument(*this, "jacobian", bytes);
+    bool has_jacobian = do_jacobian(dfdy, y, t);
+    if (!has_jacobian) {
+      scope.discard();
+    }
+    return has_jacobian;
+  }
+
+  /// Optionally, store the diagonal linear part `lambda` of the RHS, i.e.
+  ///
+  ///   f_i(y, t) = lambda_i(t) * y_i + N_i(y, t)
+  ///
+  /// where the rest `N` is what's left over. It doesn't depend on `y`.
+  ///
+  /// Returns `false` if the RHS doesn't have one; exponential integrators
+  /// need it, see `exponential.hpp`.
+  bool linear_part(Span<double> lambda, double t) const {
+    auto scope
+        = instrument(*this, "linear_part", lambda.size() * sizeof(double));
+    bool has_linear_part = do_linear_part(lambda, t);
+    if (!has_linear_part) {
+      scope.discard();
+    }
+    return has_linear_part;
+  }
+
+protected:
+  virtual void do_eval(Span<Scalar> dydt,
+                       Span<const Scalar> y,
+                       double t) const = 0;
+
+  virtual void do_eval_batch(Span<Scalar> dydt,
+                             Span<const Scalar> y,
+                             double t,
+                             std::size_t n_states,
+                             BatchLayout layout) const {
+    if (n_states == 0) {
+      return;
+    }
+
+    std::size_t n_vars = y.size() / n_states;
+    if (layout == BatchLayout::state_major) {
+      for (std::size_t k = 0; k < n_states; ++k) {
+        do_eval(dydt.subspan(k * n_vars, n_vars),
+                y.subspan(k * n_vars, n_vars),
+                t);
+      }
+      return;
+    }
+
+    // The states aren't contiguous, hence they're gathered one at a time.
+    // Once per thread, not per call, because it's sized by `n_vars` only.
+    thread_local std::vector<Scalar> y_k, dydt_k;
+    y_k.resize(n_vars);
+    dydt_k.resize(n_vars);
+    for (std::size_t k = 0; k < n_states; ++k) {
+      for (std::size_t i = 0; i < n_vars; ++i) {
+        y_k[i] = y[i * n_states + k];
+      }
+      do_eval(dydt_k, y_k, t);
+      for (std::size_t i = 0; i < n_vars; ++i) {
+        dydt[i * n_states + k] = dydt_k[i];
+      }
+    }
+  }
+
+  virtual bool do_add_scaled(Span<Scalar> /* out */,
+                             Span<const Scalar> /* base */,
+                             double /* alpha */,
+                             Span<const Scalar> /* y */,
+                             double /* t */) const {
+    return false;
+  }
+
+  virtual bool do_add_scaled_widened(Span<Scalar> /* out */,
+                                     Span<const Scalar> /* base */,
+                                     double /* alpha */,
+                                     Span<const float> /* y */,
+                                     double /* t */) const {
+    return false;
+  }
+
+  virtual bool do_jacobian(DenseMatrix & /* dfdy */,
+                           Span<const Scalar> /* y */,
+                           double /* t */) const {
+    return false;
+  }
+
+  virtual bool do_linear_part(Span<double> /* lambda */, double /* t */) const {
+    return false;
+  }
+};
+
+using RHS = BasicRHS<double>;
+
+/// A RHS which can compute any range of components of the rate of change.
+///
+/// This is what allows splitting the work between threads, see
+/// `threaded.hpp`. Computing the components `[begin, end)` may read any
+/// component of `y`, e.g. a stencil in a method of lines.
+///
+/// Like `RHS`, the public methods aren't virtual; implementations override
+/// `do_eval_range` and optionally `do_add_scaled_range`.
+template <class Scalar>
+class BasicRangeRHS : public BasicRHS<Scalar> {
+public:
+  /// Store the components `[begin, end)` of f(y, t) in `dydt`.
+  void eval_range(Span<Scalar> dydt,
+                  Span<const Scalar> y,
+                  double t,
+                  std::size_t begin,
+                  std::size_t end) const {
+    assert(begin <= end && end <= y.size());
+    auto scope
+        = instrument(*this, "eval_range", 2 * (end - begin) * sizeof(Scalar));
+    do_eval_range(dydt, y, t, begin, end);
+  }
+
+  /// Optionally, compute the components `[begin, end)` of
+  /// `out = base + alpha * f(y, t)`, see `RHS::add_scaled`.
+  ///
+  /// Whether it's supported mustn't depend on the range; hence, an empty
+  /// range asks without doing any work.
+  bool add_scaled_range(Span<Scalar> out,
+                        Span<const Scalar> base,
+                        double alpha,
+                        Span<const Scalar> y,
+                        double t,
+                        std::size_t begin,
+                        std::size_t end) const {
+    assert(begin <= end && end <= y.size());
+    auto scope = instrument(
+        *this, "add_scaled_range", 3 * (end - begin) * sizeof(Scalar));
+    bool is_fused = do_add_scaled_range(out, base, alpha, y, t, begin, end);
+    if (!is_fused) {
+      scope.discard();
+    }
+    return is_fused;
+  }
+
+protected:
+  virtual void do_eval_range(Span<Scalar> dydt,
+                             Span<const Scalar> y,
+                             double t,
+                             std::size_t begin,
+                             std::size_t end) const = 0;
+
+  virtual bool do_add_scaled_range(Span<Scalar> /* out */,
+                                   Span<const Scalar> /* base */,
+                                   double /* alpha */,
+                                   Span<const Scalar> /* y */,
+                                   double /* t */,
+                                   std::size_t /* begin */,
+                                   std::size_t /* end */) const {
+    return false;
+  }
+
+  // Already instrumented as `eval` or `add_scaled`, hence not through the
+  // public range methods.
+  void do_eval(Span<Scalar> dydt,
+               Span<const Scalar> y,
+               double t) const override {
+    do_eval_range(dydt, y, t, 0, y.size());
+  }
+
+  bool do_add_scaled(Span<Scalar> out,
+                     Span<const Scalar> base,
+                     double alpha,
+                     Span<const Scalar> y,
+                     double t) const override {
+    return do_add_scaled_range(out, base, alpha, y, t, 0, y.size());
+  }
+};
+
+using RangeRHS = BasicRangeRHS<double>;
+
+/// The RHS of dy/dt = -2 y. It's linear, i.e. `N = 0`.
+template <class Scalar>
+class BasicExpRHS : public BasicRangeRHS<Scalar> {
+public:
+  ~BasicExpRHS() override = default;
+
+protected:
+  void do_eval_range(Span<Scalar> dydt,
+                     Span<const Scalar> y,
+                     double /* t */,
+                     std::size_t begin,
+                     std::size_t end) const override {
+    if constexpr (std::is_same_v<Scalar, double>) {
+      std::size_t n = end - begin;
+      simd_scale(dydt.subspan(begin, n), -2.0, y.subspan(begin, n));
+    } else {
+      for (std::size_t i = begin; i < end; ++i) {
+        dydt[i] = Scalar(-2.0) * y[i];
+      }
+    }
+  }
+
+  bool do_add_scaled_range(Span<Scalar> out,
+                           Span<const Scalar> base,
+                           double alpha,
+                           Span<const Scalar> y,
+                           double /* t */,
+                           std::size_t begin,
+                           std::size_t end) const override {
+    if constexpr (std::is_same_v<Scalar, double>) {
+      // Scaling by `-2` is exact, hence `-2 * alpha` doesn't round differently.
+      std::size_t n = end - begin;
+      simd_axpy(out.subspan(begin, n),
+                base.subspan(begin, n),
+                -2.0 * alpha,
+                y.subspan(begin, n));
+      return true;
+    }
+
+    // Multiplying by a `double` would convert every element to `double`.
+    auto a = Scalar(alpha);
+    for (std::size_t i = begin; i < end; ++i) {
+      out[i] = base[i] + a * (Scalar(-2.0) * y[i]);
+    }
+    return true;
+  }
+
+  bool do_add_scaled_widened(Span<Scalar> out,
+                             Span<const Scalar> base,
+                             double alpha,
+                             Span<const float> y,
+                             double /* t */) const override {
+    auto a = Scalar(-2.0 * alpha);
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      out[i] = base[i] + a * Scalar(y[i]);
+    }
+    return true;
+  }
+
+  // Pointwise, hence the layout doesn't matter: the whole block is a single
+  // vectorized loop.
+  void do_eval_batch(Span<Scalar> dydt,
+                     Span<const Scalar> y,
+                     double t,
+                     std::size_t /* n_states */,
+                     BatchLayout /* layout */) const override {
+    do_eval_range(dydt, y, t, 0, y.size());
+  }
+
+  bool do_jacobian(DenseMatrix &dfdy,
+                   Span<const Scalar> y,
+                   double /* t */) const override {
+    dfdy.resize(y.size());
+    dfdy.set_zero();
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dfdy(i, i) = -2.0;
+    }
+    return true;
+  }
+
+  bool do_linear_part(Span<double> lambda, double /* t */) const override {
+    std::fill(lambda.begin(), lambda.end(), -2.0);
+    return true;
+  }
+};
+
+using ExpRHS = BasicExpRHS<double>;
+
+/// Factory for RHS selected at runtime, e.g. from a config file.
+inline std::shared_ptr<RHS> make_rhs(const std::string &rhs_name) {
+  if (rhs_name == "exp") {
+    return std::make_shared<ExpRHS>();
+  }
+
+  throw std::invalid_argument("Unknown RHS: " + rhs_name);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <type_traits>
+
+#include "instrumentation.hpp"
+#include "rhs.hpp"
+#include "simd.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// Interface of one step of a RK method, for states which are contiguous
+/// arrays of `Scalar`, e.g. a `std::vector<Scalar>`; see `span.hpp`.
+///
+/// The public methods aren't virtual, implementations override the protected
+/// `do_*` methods. See `instrumentation.hpp` for why.
+template <class Scalar>
+class BasicRKStep {
+public:
+  virtual ~BasicRKStep() = default;
+
+  /// Advance the current state `y0` (approx. y(t)) to `y1` (approx.
+  /// y(t + dt)).
+  ///
+  /// Any scratch pads are borrowed from `workspace`. Hence, steps don't have
+  /// mutable state and may be shared between threads, as long as every thread
+  /// passes its own workspace.
+  void advance(Span<Scalar> y1,
+               Span<const Scalar> y0,
+               double t,
+               double dt,
+               Workspace &workspace) const {
+    auto scope = instrument(*this, "advance", 2 * y0.size() * sizeof(Scalar));
+    do_advance(y1, y0, t, dt, workspace);
+  }
+
+  /// Same as above, using the workspace of the calling thread.
+  void advance(Span<Scalar> y1,
+               Span<const Scalar> y0,
+               double t,
+               double dt) const {
+    advance(y1, y0, t, dt, thread_local_workspace());
+  }
+
+  /// Optionally, advance `y` from `t` to `t + dt` in place.
+  ///
+  /// Saves the separate output buffer, i.e. one array of the size of the
+  /// state. If a step doesn't support it, it returns `false` without touching
+  /// `y`; the caller must then fall back to `advance`.
+  bool advance_in_place(Span<Scalar> y,
+                        double t,
+                        double dt,
+                        Workspace &workspace) const {
+    auto scope
+        = instrument(*this, "advance_in_place", 2 * y.size() * sizeof(Scalar));
+    bool is_in_place = do_advance_in_place(y, t, dt, workspace);
+    if (!is_in_place) {
+      scope.discard();
+    }
+    return is_in_place;
+  }
+
+protected:
+  virtual void do_advance(Span<Scalar> y1,
+                          Span<const Scalar> y0,
+                          double t,
+                          double dt,
+                          Workspace &workspace) const = 0;
+
+  virtual bool do_advance_in_place(Span<Scalar> /* y */,
+                                   double /* t */,
+                                   double /* dt */,
+                                   Workspace & /* workspace */) const {
+    return false;
+  }
+};
+
+using RKStep = BasicRKStep<double>;
+
+/// One step of Forward Euler.
+template <class Scalar>
+class BasicForwardEulerStep : public BasicRKStep<Scalar> {
+public:
+  ~BasicForwardEulerStep() override = default;
+
+  explicit BasicForwardEulerStep(std::shared_ptr<BasicRHS<Scalar>> rhs)
+      : rhs(std::move(rhs)) {}
+
+protected:
+  void do_advance(Span<Scalar> y1,
+                  Span<const Scalar> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+
+    // One pass: read `y0`, write `y1`.
+    if (rhs->add_scaled(y1, y0, dt, y0, t)) {
+      return;
+    }
+
+    // Two passes: read `y0`, write `dydt`; read `y0` and `dydt`, write `y1`.
+    auto &dydt = workspace.vector<Scalar>(0, y0.size());
+    (*rhs)(dydt, y0, t);
+
+    if constexpr (std::is_same_v<Scalar, double>) {
+      simd_axpy(y1, y0, dt, dydt);
+    } else {
+      auto h = Scalar(dt);
+      for (std::size_t i = 0; i < y0.size(); ++i) {
+        y1[i] = y0[i] + h * dydt[i];
+      }
+    }
+  }
+
+private:
+  std::shared_ptr<BasicRHS<Scalar>> rhs;
+};
+
+using ForwardEulerStep = BasicForwardEulerStep<double>;
@@ -0,0 +1,225 @@
+#pragma once
+
+// Explicit SIMD for the two loops every explicit step is made of:
+//
+//   out[i] = x[i] + a * y[i]    (`simd_axpy`, the update of a stage)
+//   out[i] = a * x[i]           (`simd_scale`, e.g. the RHS of `ExpRHS`)
+//
+// The auto-vectorizer has to assume that `out` may overlap `x` or `y` at an
+// offset, and it only uses the instruction set the binary is compiled for.
+// Here the loops are written with intrinsics, once for AVX2 and once for
+// AVX-512, and the best version the CPU supports is picked the first time a
+// kernel is called. Other compilers or CPUs get the plain loops.
+//
+// The tail, i.e. the last `n % width` elements, is handled with masked loads
+// and stores. Therefore, the kernels never touch memory outside the spans and
+// work on any storage, not only on padded arrays.
+//
+// Note: the SIMD versions use fused multiply-adds, hence the results may
+// differ from the plain loops in the last bit.
+
+#include <cassert>
+#include <cstddef>
+
+#include "span.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ODE_SOLVERS_HAS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/// The instruction sets the kernels exist for, in increasing order.
+enum class SimdLevel { scalar = 0, avx2 = 1, avx512 = 2 };
+
+inline const char *simd_level_name(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::avx512:
+    return "avx512";
+  case SimdLevel::avx2:
+    return "avx2";
+  default:
+    return "scalar";
+  }
+}
+
+/// The best level supported by the CPU running the program.
+inline SimdLevel detect_simd_level() {
+#ifdef ODE_SOLVERS_HAS_X86_SIMD
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::avx512;
+  }
+
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SimdLevel::avx2;
+  }
+#endif
+
+  return SimdLevel::scalar;
+}
+
+namespace simd_detail {
+
+inline void axpy_scalar(double *out,
+                        const double *x,
+                        double a,
+                        const double *y,
+                        std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = x[i] + a * y[i];
+  }
+}
+
+inline void
+scale_scalar(double *out, double a, const double *x, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = a * x[i];
+  }
+}
+
+#ifdef ODE_SOLVERS_HAS_X86_SIMD
+// The mask of the first `n_active` of four lanes.
+__attribute__((target("avx2"))) inline __m256i
+avx2_tail_mask(std::size_t n_active) {
+  return _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long)n_active),
+                            _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
+__attribute__((target("avx2,fma"))) inline void axpy_avx2(double *out,
+                                                         const double *x,
+                                                         double a,
+                                                         const double *y,
+                                                         std::size_t n) {
+  constexpr std::size_t width = 4;
+  __m256d a_ = _mm256_set1_pd(a);
+
+  std::size_t i = 0;
+  for (; i + width <= n; i += width) {
+    __m256d x_ = _mm256_loadu_pd(x + i);
+    __m256d y_ = _mm256_loadu_pd(y + i);
+    _mm256_storeu_pd(out + i, _mm256_fmadd_pd(a_, y_, x_));
+  }
+
+  if (i < n) {
+    __m256i mask = avx2_tail_mask(n - i);
+    __m256d x_ = _mm256_maskload_pd(x + i, mask);
+    __m256d y_ = _mm256_maskload_pd(y + i, mask);
+    _mm256_maskstore_pd(out + i, mask, _mm256_fmadd_pd(a_, y_, x_));
+  }
+}
+
+__attribute__((target("avx2"))) inline void
+scale_avx2(double *out, double a, const double *x, std::size_t n) {
+  constexpr std::size_t width = 4;
+  __m256d a_ = _mm256_set1_pd(a);
+
+  std::size_t i = 0;
+  for (; i + width <= n; i += width) {
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(a_, _mm256_loadu_pd(x + i)));
+  }
+
+  if (i < n) {
+    __m256i mask = avx2_tail_mask(n - i);
+    __m256d x_ = _mm256_maskload_pd(x + i, mask);
+    _mm256_maskstore_pd(out + i, mask, _mm256_mul_pd(a_, x_));
+  }
+}
+
+__attribute__((target("avx512f"))) inline void axpy_avx512(double *out,
+                                                          const double *x,
+                                                          double a,
+                                                          const double *y,
+                                                          std::size_t n) {
+  constexpr std::size_t width = 8;
+  __m512d a_ = _mm512_set1_pd(a);
+
+  std::size_t i = 0;
+  for (; i + width <= n; i += width) {
+    __m512d x_ = _mm512_loadu_pd(x + i);
+    __m512d y_ = _mm512_loadu_pd(y + i);
+    _mm512_storeu_pd(out + i, _mm512_fmadd_pd(a_, y_, x_));
+  }
+
+  if (i < n) {
+    __mmask8 mask = __mmask8((1u << (n - i)) - 1u);
+    __m512d x_ = _mm512_maskz_loadu_pd(mask, x + i);
+    __m512d y_ = _mm512_maskz_loadu_pd(mask, y + i);
+    _mm512_mask_storeu_pd(out + i, mask, _mm512_fmadd_pd(a_, y_, x_));
+  }
+}
+
+__attribute__((target("avx512f"))) inline void
+scale_avx512(double *out, double a, const double *x, std::size_t n) {
+  constexpr std::size_t width = 8;
+  __m512d a_ = _mm512_set1_pd(a);
+
+  std::size_t i = 0;
+  for (; i + width <= n; i += width) {
+    _mm512_storeu_pd(out + i, _mm512_mul_pd(a_, _mm512_loadu_pd(x + i)));
+  }
+
+  if (i < n) {
+    __mmask8 mask = __mmask8((1u << (n - i)) - 1u);
+    __m512d x_ = _mm512_maskz_loadu_pd(mask, x + i);
+    _mm512_mask_storeu_pd(out + i, mask, _mm512_mul_pd(a_, x_));
+  }
+}
+#endif
+
+/// The kernels of one level.
+struct Kernels {
+  SimdLevel level;
+  void (*axpy)(double *, const double *, double, const double *, std::size_t);
+  void (*scale)(double *, double, const double *, std::size_t);
+};
+
+inline Kernels kernels_for(SimdLevel level) {
+#ifdef ODE_SOLVERS_HAS_X86_SIMD
+  if (level == SimdLevel::avx512) {
+    return {level, axpy_avx512, scale_avx512};
+  }
+
+  if (level == SimdLevel::avx2) {
+    return {level, axpy_avx2, scale_avx2};
+  }
+#endif
+
+  return {SimdLevel::scalar, axpy_scalar, scale_scalar};
+}
+
+// Selected once, on first use.
+inline Kernels &active_kernels() {
+  static Kernels kernels = kernels_for(detect_simd_level());
+  return kernels;
+}
+
+} // namespace simd_detail
+
+/// The level of the kernels in use.
+inline SimdLevel simd_level() { return simd_detail::active_kernels().level; }
+
+/// Use the kernels of `level`, or the best supported level below it; returns
+/// the level actually used. Meant for benchmarks, not thread-safe.
+inline SimdLevel set_simd_level(SimdLevel level) {
+  if (int(level) > int(detect_simd_level())) {
+    level = detect_simd_level();
+  }
+
+  simd_detail::active_kernels() = simd_detail::kernels_for(level);
+  return level;
+}
+
+/// `out[i] = x[i] + a * y[i]`. `out` may be the same memory as `x` or `y`.
+inline void simd_axpy(Span<double> out,
+                      Span<const double> x,
+                      double a,
+                      Span<const double> y) {
+  assert(out.size() == x.size() && out.size() == y.size());
+  simd_detail::active_kernels().axpy(
+      out.data(), x.data(), a, y.data(), out.size());
+}
+
+/// `out[i] = a * x[i]`. `out` may be the same memory as `x`.
+inline void simd_scale(Span<double> out, double a, Span<const double> x) {
+  assert(out.size() == x.size());
+  simd_detail::active_kernels().scale(out.data(), a, x.data(), out.size());
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// Interface of an observer of the trajectory computed by `solve_ode`.
+template <class Scalar>
+class BasicObserver {
+public:
+  virtual ~BasicObserver() = default;
+
+  /// Called with the initial state, i.e. `step == 0`, and after every step.
+  virtual void operator()(std::size_t step, double t, Span<const Scalar> y) = 0;
+};
+
+using Observer = BasicObserver<double>;
+
+/// An observer which ignores everything.
+template <class Scalar>
+class BasicNullObserver : public BasicObserver<Scalar> {
+public:
+  void operator()(std::size_t /* step */,
+                  double /* t */,
+                  Span<const Scalar> /* y */) override {}
+};
+
+using NullObserver = BasicNullObserver<double>;
+
+/// Integrate `y` in place from `t = 0` to `T` with steps of size `dt`.
+///
+/// `y` may be any contiguous storage, e.g. a memory mapped file; on entry
+/// it's the initial state, on exit the state at `T`. The `observer` sees the
+/// initial state and the state after every step.
+///
+/// Steps which can advance in place do so, then the only copy of the state
+/// is `y` itself. For all others `buffer` is resized to the size of the state
+/// on the first step; the two alternate, and if the final state ends up in
+/// the buffer it's copied back into `y`. Passing the same `buffer` to many
+/// solves avoids allocating it every time, see `solver_context.hpp`.
+template <class Scalar>
+void solve_ode(const BasicRKStep<Scalar> &rk_step,
+               Span<Scalar> y,
+               AlignedVector<Scalar> &buffer,
+               double T,
+               double dt,
+               BasicObserver<Scalar> &observer,
+               Workspace &workspace) {
+  auto y0 = y;
+
+  double t = 0.0;
+  std::size_t step = 0;
+  observer(step, t, y0);
+
+  while (t < T) {
+    if (!rk_step.advance_in_place(y0, t, dt, workspace)) {
+      if (buffer.size() != y.size()) {
+        buffer.resize(y.size());
+      }
+
+      auto y1 = y0.data() == y.data() ? Span<Scalar>(buffer) : y;
+      rk_step.advance(y1, y0, t, dt, workspace);
+      y0 = y1;
+    }
+
+    t += dt;
+    step += 1;
+
+    observer(step, t, y0);
+  }
+
+  if (y0.data() != y.data()) {
+    std::copy(y0.begin(), y0.end(), y.begin());
+  }
+}
+
+/// Same as above, allocating the buffer if needed.
+template <class Scalar>
+void solve_ode(const BasicRKStep<Scalar> &rk_step,
+               Span<Scalar> y,
+               double T,
+               double dt,
+               BasicObserver<Scalar> &observer,
+               Workspace &workspace) {
+  AlignedVector<Scalar> buffer;
+  solve_ode(rk_step, y, buffer, T, dt, observer, workspace);
+}
+
+/// Integrate from `t = 0` to `T` with steps of size `dt`.
+///
+/// Same as above, for a state owned by a `std::vector`.
+template <class Scalar>
+std::vector<Scalar> solve_ode(const BasicRKStep<Scalar> &rk_step,
+                              std::vector<Scalar> y0,
+                              double T,
+                              double dt,
+                              BasicObserver<Scalar> &observer,
+                              Workspace &workspace) {
+  solve_ode(rk_step, Span<Scalar>(y0), T, dt, observer, workspace);
+  return y0;
+}
+
+/// Same as above, using the workspace of the calling thread.
+template <class Scalar>
+std::vector<Scalar> solve_ode(const BasicRKStep<Scalar> &rk_step,
+                              std::vector<Scalar> y0,
+                              double T,
+                              double dt,
+                              BasicObserver<Scalar> &observer) {
+  return solve_ode(
+      rk_step, std::move(y0), T, dt, observer, thread_local_workspace());
+}
+
+/// Integrate from `t = 0` to `T` with steps of size `dt`.
+template <class Scalar>
+std::vector<Scalar> solve_ode(const BasicRKStep<Scalar> &rk_step,
+                              std::vector<Scalar> y0,
+                              double T,
+                              double dt,
+                              Workspace &workspace) {
+  auto observer = BasicNullObserver<Scalar>{};
+  return solve_ode(rk_step, std::move(y0), T, dt, observer, workspace);
+}
+
+/// Same as above, using the workspace of the calling thread.
+template <class Scalar>
+std::vector<Scalar> solve_ode(const BasicRKStep<Scalar> &rk_step,
+                              std::vector<Scalar> y0,
+                              double T,
+                              double dt) {
+  return solve_ode(rk_step, std::move(y0), T, dt, thread_local_workspace());
+}
+
+/// Integrate `y` in place from `t = 0` to `T` with steps of size `dt`.
+template <class Scalar>
+void solve_ode(const BasicRKStep<Scalar> &rk_step,
+               Span<Scalar> y,
+               double T,
+               double dt,
+               Workspace &workspace) {
+  auto observer = BasicNullObserver<Scalar>{};
+  solve_ode(rk_step, y, T, dt, observer, workspace);
+}
+
+/// Same as above, using the workspace of the calling thread.
+template <class Scalar>
+void solve_ode(const BasicRKStep<Scalar> &rk_step,
+               Span<Scalar> y,
+               double T,
+               double dt) {
+  solve_ode(rk_step, y, T, dt, thread_local_workspace());
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+// With a fixed `dt` the step size is dictated by the hardest part of the
+// solution and the whole run is over-resolved. An adaptive driver picks `dt`
+// such that the estimated local error of each step meets a tolerance.
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "dormand_prince.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// Parameters of the adaptive time stepping.
+struct AdaptiveOptions {
+  double atol = 1e-6;
+  double rtol = 1e-6;
+
+  /// Size of the first attempted step.
+  double dt_initial = 1e-3;
+
+  /// The step size changes by at most these factors.
+  double safety = 0.9;
+  double min_factor = 0.2;
+  double max_factor = 5.0;
+};
+
+/// Counts of accepted and rejected steps.
+struct AdaptiveStats {
+  std::size_t n_accepted = 0;
+  std::size_t n_rejected = 0;
+};
+
+/// Weighted RMS norm of the error estimate, a step is acceptable if it's at
+/// most one.
+inline double error_norm(Span<const double> y_err,
+                         Span<const double> y0,
+                         Span<const double> y1,
+                         double atol,
+                         double rtol) {
+  double sum = 0.0;
+  for (std::size_t i = 0; i < y_err.size(); ++i) {
+    double scale
+        = atol + rtol * std::max(std::abs(y0[i]), std::abs(y1[i]));
+    double e = y_err[i] / scale;
+    sum += e * e;
+  }
+
+  return std::sqrt(sum / double(y_err.size()));
+}
+
+/// Integrate `y` in place from `t = 0` to `T` with step size control.
+///
+/// The FSAL stage of an accepted step is reused as the first stage of the
+/// next step. Hence, Dormand-Prince costs six RHS evaluations per attempted
+/// step, plus one to get started.
+///
+/// A step whose error estimate isn't finite, e.g. because the RHS returned
+/// NaN, is rejected and the step size shrinks by `min_factor`. If that
+/// doesn't help, the step size underflows and `std::runtime_error` is thrown.
+///
+/// Uses the vector slots `9, ..., 12` of the workspace, the step may use the
+/// ones below.
+inline void solve_ode_adaptive(const EmbeddedRKStep &rk_step,
+                               Span<double> y,
+                               double T,
+                               const AdaptiveOptions &options,
+                               AdaptiveStats &stats,
+                               Workspace &workspace) {
+  std::size_t n_vars = y.size();
+  Span<double> y0 = y;
+  Span<double> y1 = workspace.vector(9, n_vars);
+  Span<double> y_err = workspace.vector(10, n_vars);
+  Span<double> dydt0 = workspace.vector(11, n_vars);
+  Span<double> dydt1 = workspace.vector(12, n_vars);
+
+  double exponent = -1.0 / (rk_step.error_order() + 1.0);
+
+  double t = 0.0;
+  double dt = options.dt_initial;
+  rk_step.first_stage(dydt0, y0, t);
+
+  while (t < T) {
+    bool is_last = t + dt >= T;
+    if (is_last) {
+      dt = T - t;
+    }
+
+    rk_step.advance_with_error(
+        y1, y_err, dydt1, y0, dydt0, t, dt, workspace);
+    double err = error_norm(y_err, y0, y1, options.atol, options.rtol);
+
+    double factor = options.min_factor;
+    if (!std::isfinite(err)) {
+      // Neither `err > 0.0` nor `err <= 1.0` holds for NaN.
+      stats.n_rejected += 1;
+    } else {
+      factor = options.max_factor;
+      if (err > 0.0) {
+        factor = std::clamp(options.safety * std::pow(err, exponent),
+                            options.min_factor,
+                            options.max_factor);
+      }
+
+      if (err <= 1.0) {
+        t = is_last ? T : t + dt;
+        std::swap(y0, y1);
+        std::swap(dydt0, dydt1);
+        stats.n_accepted += 1;
+      } else {
+        // Don't grow the step right after a rejection.
+        factor = std::min(factor, 1.0);
+        stats.n_rejected += 1;
+      }
+    }
+
+    dt *= factor;
+    if (t < T && t + dt == t) {
+      throw std::runtime_error("solve_ode_adaptive: step size underflow.");
+    }
+  }
+
+  if (y0.data() != y.data()) {
+    std::copy(y0.begin(), y0.end(), y.begin());
+  }
+}
+
+/// Integrate from `t = 0` to `T` with step size control.
+///
+/// Same as above, for a state owned by a `std::vector`, using the workspace
+/// of the calling thread.
+inline std::vector<double> solve_ode_adaptive(const EmbeddedRKStep &rk_step,
+                                              std::vector<double> y0,
+                                              double T,
+                                              const AdaptiveOptions &options,
+                                              AdaptiveStats &stats) {
+  solve_ode_adaptive(rk_step,
+                     Span<double>(y0),
+                     T,
+                     options,
+                     stats,
+                     thread_local_workspace());
+  return y0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Solving the same ODE many times with different initial conditions, e.g. in
+// a Monte Carlo loop, the obvious code is
+//
+//   for (...) {
+//     auto rk_step = ForwardEulerStep(std::make_shared<ExpRHS>());
+//     auto y1 = solve_ode(rk_step, sample_y0(), T, dt);
+//   }
+//
+// Every iteration allocates the RHS, the state, the second buffer of
+// `solve_ode` and, unless the thread local workspace is warm, the scratch
+// pads of the step. For short solves the allocator dominates.
+//
+// A `SolverContext` owns all of these and is reused. After the first solve,
+// i.e. once every buffer has its final size, `reset` followed by `solve`
+// doesn't allocate.
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+/// Everything needed to solve an ODE repeatedly without allocating.
+///
+/// Note: steps which keep a history in the workspace, i.e. `BDFStep`,
+/// rebuild it whenever a new trajectory starts and therefore still allocate.
+///
+/// Not thread-safe; use one context per thread. The step itself may be
+/// shared between the contexts.
+template <class Scalar>
+class BasicSolverContext {
+public:
+  explicit BasicSolverContext(
+      std::shared_ptr<const BasicRKStep<Scalar>> rk_step)
+      : rk_step(std::move(rk_step)) {
+    if (this->rk_step == nullptr) {
+      throw std::invalid_argument("SolverContext: `rk_step` is null.");
+    }
+  }
+
+  /// Set the initial state, doesn't allocate unless `y0` is larger than any
+  /// state before.
+  void reset(Span<const Scalar> y0) { y.assign(y0.begin(), y0.end()); }
+
+  /// Integrate the current state from `t = 0` to `T`.
+  Span<const Scalar> solve(double T, double dt) {
+    auto observer = BasicNullObserver<Scalar>{};
+    return solve(T, dt, observer);
+  }
+
+  /// Same as above, `observer` sees every step.
+  Span<const Scalar>
+  solve(double T, double dt, BasicObserver<Scalar> &observer) {
+    solve_ode(*rk_step, Span<Scalar>(y), buffer, T, dt, observer, workspace);
+    return y;
+  }
+
+  /// The initial state after `reset`, the final state after `solve`.
+  Span<const Scalar> state() const { return y; }
+
+  const BasicRKStep<Scalar> &step() const { return *rk_step; }
+
+private:
+  std::shared_ptr<const BasicRKStep<Scalar>> rk_step;
+
+  AlignedVector<Scalar> y;
+  AlignedVector<Scalar> buffer;
+  Workspace workspace;
+};
+
+using SolverContext = BasicSolverContext<double>;
@@ -0,0 +1,73 @@
+#pragma once
+
+// A state doesn't have to live in a `std::vector`. It may be a memory mapped
+// file, a buffer owned by a C library, or one column of a struct of arrays.
+// Copying it into a vector before every solve and back afterwards costs two
+// passes over memory, for nothing.
+//
+// Hence, the `RHS` and `RKStep` interfaces take a `Span`, i.e. a pointer and a
+// size, which doesn't own the memory it points to. A `std::vector` converts
+// to a `Span` implicitly, so code written for vectors keeps working
+// unchanged; the vector is the thin adapter. (C++20 has `std::span`; this is
+// the subset we need, in C++17.)
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+/// A non-owning view of `size` contiguous elements of type `T`.
+///
+/// `Span<const T>` is the read-only version. Like a reference, a span doesn't
+/// keep the memory alive, nor can it be resized.
+template <class T>
+class Span {
+private:
+  // Anything with `data()` and `size()`, e.g. `std::vector<T>`, a
+  // `Span<U>` or `std::array<T, N>`.
+  template <class Container>
+  using EnableIfContainer = std::enable_if_t<
+      std::is_convertible_v<decltype(std::declval<Container &>().data()), T *>
+      && std::is_convertible_v<decltype(std::declval<Container &>().size()),
+                               std::size_t>>;
+
+public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+
+  Span() = default;
+  Span(T *data, std::size_t size) : data_(data), size_(size) {}
+
+  template <class Container, class = EnableIfContainer<Container>>
+  Span(Container &container)
+      : data_(container.data()), size_(container.size()) {}
+
+  // Only read-only spans may point into temporaries or `const` containers.
+  template <class Container,
+            class U = T,
+            class = std::enable_if_t<std::is_const_v<U>>,
+            class = EnableIfContainer<const Container>>
+  Span(const Container &container)
+      : data_(container.data()), size_(container.size()) {}
+
+  T *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Unchecked, like `std::vector`. An `assert` here would be evaluated for
+  // every element in the innermost loops.
+  T &operator[](std::size_t i) const { return data_[i]; }
+
+  T *begin() const { return data_; }
+  T *end() const { return data_ + size_; }
+
+  /// The `count` elements starting at `offset`.
+  Span subspan(std::size_t offset, std::size_t count) const {
+    assert(offset + count <= size_);
+    return Span(data_ + offset, count);
+  }
+
+private:
+  T *data_ = nullptr;
+  std::size_t size_ = 0;
+};
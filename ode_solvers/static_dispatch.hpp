@@ -0,0 +1,126 @@
+#pragma once
+
+// `solve_ode` calls the virtual `RKStep::do_advance` which calls the virtual
+// `RHS::do_eval`. Neither call can be inlined, hence the compiler sees three
+// separate loops: the one over time steps, the RHS and the update. For small
+// states the calls dominate, for large states the RHS writes `dydt` only to
+// have the update read it back.
+//
+// If the RHS and the scheme are known at compile time, we can do better. A
+// "kernel" is any class with a (non-virtual) method
+//
+//   double operator()(Span<const double> y, std::size_t i, double t)
+//
+// which returns the `i`-th component of f(y, t). Since it's evaluated one
+// component at a time, the body of the RHS ends up inside the update loop.
+// Stencils, e.g. from a method of lines, are fine: the kernel may read any
+// entry of `y`.
+//
+// What this buys is the two virtual calls per step, and the function call per
+// component if the RHS can't be vectorized on its own. Both matter for small
+// states. For large states the virtual steps already fuse the RHS into the
+// update, see `RHS::add_scaled`; then both are the same memory bound loop and
+// equally fast.
+//
+// The virtual hierarchy remains the runtime configurable front end, see
+// `ode_solver.hpp`.
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "rhs.hpp"
+#include "span.hpp"
+
+/// The kernel of dy/dt = -2 y.
+struct ExpKernel {
+  double
+  operator()(Span<const double> y, std::size_t i, double /* t */) const {
+    return -2.0 * y[i];
+  }
+};
+
+/// Adapts a kernel to the `RHS` interface.
+template <class Kernel>
+class KernelRHS : public RHS {
+public:
+  explicit KernelRHS(Kernel kernel = Kernel{}) : kernel(std::move(kernel)) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dydt[i] = kernel(y, i, t);
+    }
+  }
+
+private:
+  Kernel kernel;
+};
+
+/// Forward Euler with the RHS known at compile time.
+///
+/// Note that it doesn't need a scratch pad for `dydt`.
+template <class Kernel>
+class StaticForwardEulerStep {
+public:
+  explicit StaticForwardEulerStep(Kernel kernel = Kernel{})
+      : kernel(std::move(kernel)) {}
+
+  void
+  advance(Span<double> y1, Span<const double> y0, double t, double dt) const {
+    assert(y1.size() == y0.size());
+
+    for (std::size_t i = 0; i < y0.size(); ++i) {
+      y1[i] = y0[i] + dt * kernel(y0, i, t);
+    }
+  }
+
+private:
+  Kernel kernel;
+};
+
+/// Integrate `y` in place from `t = 0` to `T`; the same loop as `solve_ode`,
+/// but `Step::advance` is resolved at compile time and can be inlined.
+///
+/// The state alternates between `y` and `buffer`, which is resized to the size
+/// of the state if needed.
+template <class Step>
+void solve_ode_static(const Step &step,
+                      Span<double> y,
+                      AlignedVector<double> &buffer,
+                      double T,
+                      double dt) {
+  if (buffer.size() != y.size()) {
+    buffer.resize(y.size());
+  }
+
+  Span<double> y0 = y;
+  Span<double> y1 = buffer;
+
+  double t = 0.0;
+  while (t < T) {
+    step.advance(y1, y0, t, dt);
+
+    std::swap(y0, y1);
+    t += dt;
+  }
+
+  if (y0.data() != y.data()) {
+    std::copy(y0.begin(), y0.end(), y.begin());
+  }
+}
+
+/// Integrate from `t = 0` to `T` with steps of size `dt`.
+template <class Step>
+std::vector<double> solve_ode_static(const Step &step,
+                                     std::vector<double> y0,
+                                     double T,
+                                     double dt) {
+  AlignedVector<double> buffer;
+  solve_ode_static(step, Span<double>(y0), buffer, T, dt);
+  return y0;
+}
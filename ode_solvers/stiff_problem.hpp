@@ -0,0 +1,78 @@
+#pragma once
+
+// A stiff test problem (Prothero-Robinson):
+//
+//   dy_i/dt = -lambda_i (y_i - cos(t)) - sin(t),
+//
+// with exact solution
+//
+//   y_i(t) = cos(t) + (y_i(0) - 1) exp(-lambda_i t).
+//
+// After a short transient the solution is simply `cos(t)`, but explicit
+// schemes need `dt < 2 / max(lambda_i)` nevertheless.
+
+#include <cmath>
+#include <vector>
+
+#include "dense_matrix.hpp"
+#include "rhs.hpp"
+#include "span.hpp"
+
+class ProtheroRobinsonRHS : public RHS {
+public:
+  explicit ProtheroRobinsonRHS(std::vector<double> lambda)
+      : lambda(std::move(lambda)) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    double cos_t = std::cos(t);
+    double sin_t = std::sin(t);
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dydt[i] = -lambda[i] * (y[i] - cos_t) - sin_t;
+    }
+  }
+
+  bool do_jacobian(DenseMatrix &dfdy,
+                   Span<const double> y,
+                   double /* t */) const override {
+    dfdy.resize(y.size());
+    dfdy.set_zero();
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dfdy(i, i) = -lambda[i];
+    }
+    return true;
+  }
+
+  // The linear part is `-lambda_i * y_i`, N is `lambda_i * cos(t) - sin(t)`.
+  bool do_linear_part(Span<double> diagonal, double /* t */) const override {
+    for (std::size_t i = 0; i < diagonal.size(); ++i) {
+      diagonal[i] = -lambda[i];
+    }
+    return true;
+  }
+
+private:
+  std::vector<double> lambda;
+};
+
+/// `n` decay rates, logarithmically spaced from `1` to `lambda_max`.
+inline std::vector<double> stiff_decay_rates(std::size_t n, double lambda_max) {
+  auto lambda = std::vector<double>(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    double s = n == 1 ? 1.0 : double(i) / double(n - 1);
+    lambda[i] = std::pow(lambda_max, s);
+  }
+  return lambda;
+}
+
+inline std::vector<double> stiff_soln(const std::vector<double> &lambda,
+                                      const std::vector<double> &y0,
+                                      double t) {
+  auto y = std::vector<double>(y0.size());
+  for (std::size_t i = 0; i < y0.size(); ++i) {
+    y[i] = std::cos(t) + (y0[i] - 1.0) * std::exp(-lambda[i] * t);
+  }
+  return y;
+}
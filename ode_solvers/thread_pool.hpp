@@ -0,0 +1,115 @@
+#pragma once
+
+// Spawning threads costs tens of microseconds. That's fine once per run, but
+// not once per time step. Hence we create the threads once and keep them
+// waiting for work.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A fixed set of threads which persist for the lifetime of the pool.
+///
+/// `run` executes a task on every thread of the pool and waits for all of
+/// them to finish. The calling thread participates as thread `0`. Tasks must
+/// not throw and must not call `run` themselves; and only one thread may call
+/// `run` at a time.
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t n_threads
+                      = std::thread::hardware_concurrency()) {
+    n_threads = std::max(n_threads, std::size_t(1));
+    for (std::size_t thread_id = 1; thread_id < n_threads; ++thread_id) {
+      workers.emplace_back([this, thread_id]() { work(thread_id); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+      generation += 1;
+    }
+    start.notify_all();
+
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  std::size_t n_threads() const { return workers.size() + 1; }
+
+  /// Call `task(thread_id)` once on each thread of the pool.
+  template <class Task>
+  void run(const Task &task) {
+    if (workers.empty()) {
+      task(std::size_t(0));
+      return;
+    }
+
+    // We don't store a `std::function` since that might allocate. A pointer
+    // to the task and a function which knows its type suffice.
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      task_ptr = &task;
+      task_invoke = [](const void *ptr, std::size_t thread_id) {
+        (*static_cast<const Task *>(ptr))(thread_id);
+      };
+      n_running = workers.size();
+      generation += 1;
+    }
+    start.notify_all();
+
+    task(std::size_t(0));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return n_running == 0; });
+  }
+
+private:
+  void work(std::size_t thread_id) {
+    std::size_t seen_generation = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      start.wait(lock, [&]() { return generation != seen_generation; });
+      seen_generation = generation;
+
+      if (stop) {
+        return;
+      }
+
+      auto invoke = task_invoke;
+      auto ptr = task_ptr;
+
+      lock.unlock();
+      invoke(ptr, thread_id);
+      lock.lock();
+
+      n_running -= 1;
+      if (n_running == 0) {
+        done.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers;
+
+  // Everything below is protected by `mutex`.
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+
+  std::size_t generation = 0;
+  std::size_t n_running = 0;
+  bool stop = false;
+
+  const void *task_ptr = nullptr;
+  void (*task_invoke)(const void *, std::size_t) = nullptr;
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+// Multithreaded stepping for large state vectors, e.g. method of lines with
+// 10^7 unknowns.
+//
+// The index range is split into chunks small enough that the pieces of `y0`,
+// `dydt` and `y1` belonging to one chunk fit into L2 cache. Each thread owns a
+// contiguous block of chunks and the assignment is the same for every loop
+// and every step. Therefore, a thread computes the RHS on a chunk and then
+// immediately updates the same chunk, reusing data it has just touched.
+//
+// On machines with several NUMA nodes the same partition decides where the
+// memory lives. A page is placed on the node of the thread which first writes
+// to it. `AlignedVector` doesn't zero what it allocates, hence the scratch
+// vectors of the steps and the buffer of `solve_ode` are first written by
+// the thread owning the chunk. The state itself should be created by
+// `ThreadedExecution::make_vector`, for the same reason. This only helps if
+// the threads don't migrate between nodes, e.g. if they're pinned.
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "workspace.hpp"
+
+/// Splits `[0, n)` into chunks and the chunks into one block per thread.
+class ChunkPartition {
+public:
+  ChunkPartition(std::size_t n, std::size_t chunk_size, std::size_t n_threads)
+      : n(n), chunk_size(chunk_size), n_threads(n_threads) {
+    assert(chunk_size > 0);
+  }
+
+  std::size_t n_chunks() const { return (n + chunk_size - 1) / chunk_size; }
+
+  /// The chunks `[first_chunk(p), first_chunk(p + 1))` belong to thread `p`.
+  std::size_t first_chunk(std::size_t thread_id) const {
+    return thread_id * n_chunks() / n_threads;
+  }
+
+  std::size_t chunk_begin(std::size_t chunk) const {
+    return chunk * chunk_size;
+  }
+
+  std::size_t chunk_end(std::size_t chunk) const {
+    return std::min((chunk + 1) * chunk_size, n);
+  }
+
+private:
+  std::size_t n;
+  std::size_t chunk_size;
+  std::size_t n_threads;
+};
+
+/// Execution policy which runs loops over `[0, n)` on a shared thread pool.
+class ThreadedExecution {
+public:
+  // Three vectors of doubles per unknown, 8192 unknowns are 192 KiB.
+  static constexpr std::size_t default_chunk_size = 8192;
+
+  explicit ThreadedExecution(std::shared_ptr<ThreadPool> pool,
+                             std::size_t chunk_size = default_chunk_size)
+      : pool(std::move(pool)), chunk_size(chunk_size) {}
+
+  ChunkPartition partition(std::size_t n) const {
+    return ChunkPartition(n, chunk_size, pool->n_threads());
+  }
+
+  /// Call `f(begin, end)` for every chunk of `[0, n)`.
+  template <class F>
+  void for_each_chunk(std::size_t n, const F &f) const {
+    auto chunks = partition(n);
+    pool->run([&chunks, &f](std::size_t thread_id) {
+      std::size_t last = chunks.first_chunk(thread_id + 1);
+      for (std::size_t c = chunks.first_chunk(thread_id); c < last; ++c) {
+        f(chunks.chunk_begin(c), chunks.chunk_end(c));
+      }
+    });
+  }
+
+  /// A vector of `n` copies of `value`; each chunk is first written by the
+  /// thread which owns it in `for_each_chunk`.
+  template <class Scalar = double>
+  AlignedVector<Scalar> make_vector(std::size_t n, Scalar value) const {
+    auto x = AlignedVector<Scalar>();
+    x.resize(n);
+    for_each_chunk(n, [&x, value](std::size_t begin, std::size_t end) {
+      std::fill(x.begin() + begin, x.begin() + end, value);
+    });
+    return x;
+  }
+
+  /// A copy of `y`, e.g. the initial state; each chunk is first written by
+  /// the thread which owns it in `for_each_chunk`.
+  template <class Scalar>
+  AlignedVector<Scalar> make_vector(Span<const Scalar> y) const {
+    auto x = AlignedVector<Scalar>();
+    x.resize(y.size());
+    for_each_chunk(y.size(), [&x, y](std::size_t begin, std::size_t end) {
+      std::copy(y.begin() + begin, y.begin() + end, x.begin() + begin);
+    });
+    return x;
+  }
+
+private:
+  std::shared_ptr<ThreadPool> pool;
+  std::size_t chunk_size;
+};
+
+/// Evaluates a `RangeRHS` in parallel; for steps which only see a `RHS`.
+class ThreadedRHS : public RHS {
+public:
+  ThreadedRHS(std::shared_ptr<RangeRHS> rhs, ThreadedExecution execution)
+      : rhs(std::move(rhs)), execution(std::move(execution)) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    execution.for_each_chunk(y.size(), [&](std::size_t begin, std::size_t end) {
+      rhs->eval_range(dydt, y, t, begin, end);
+    });
+  }
+
+  bool do_linear_part(Span<double> lambda, double t) const override {
+    return rhs->linear_part(lambda, t);
+  }
+
+private:
+  std::shared_ptr<RangeRHS> rhs;
+  ThreadedExecution execution;
+};
+
+/// Forward Euler, multithreaded.
+///
+/// The RHS and the update of a chunk are done by the same thread back to
+/// back, or fused if the RHS supports it; and there's only one
+/// synchronization per step.
+///
+/// Uses the vector slot 0 of the workspace, unless the update is fused.
+class ThreadedForwardEulerStep : public RKStep {
+public:
+  ThreadedForwardEulerStep(std::shared_ptr<RangeRHS> rhs,
+                           ThreadedExecution execution)
+      : rhs(std::move(rhs)), execution(std::move(execution)) {}
+
+protected:
+  void do_advance(Span<double> y1,
+                  Span<const double> y0,
+                  double t,
+                  double dt,
+                  Workspace &workspace) const override {
+    assert(y1.size() == y0.size());
+
+    // The fused update needs no scratch, which would be another vector of
+    // the size of the state.
+    if (rhs->add_scaled_range(y1, y0, dt, y0, t, 0, 0)) {
+      execution.for_each_chunk(
+          y0.size(), [&](std::size_t begin, std::size_t end) {
+            rhs->add_scaled_range(y1, y0, dt, y0, t, begin, end);
+          });
+      return;
+    }
+
+    // Borrowed by the calling thread, but shared by all threads of the pool;
+    // each writes only its own chunks. Including the first time, which is
+    // what places its pages, see above.
+    auto &dydt = workspace.vector(0, y0.size());
+
+    execution.for_each_chunk(
+        y0.size(), [&](std::size_t begin, std::size_t end) {
+          rhs->eval_range(dydt, y0, t, begin, end);
+
+          for (std::size_t i = begin; i < end; ++i) {
+            y1[i] = y0[i] + dt * dydt[i];
+          }
+        });
+  }
+
+private:
+  std::shared_ptr<RangeRHS> rhs;
+  ThreadedExecution execution;
+};
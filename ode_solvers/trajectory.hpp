@@ -0,0 +1,203 @@
+#pragma once
+
+// Streaming trajectories to disk. Collecting every state in a growing
+// container means the trajectory must fit into RAM; and every time the
+// container grows the integrator stalls while everything is copied.
+//
+// Instead the `TrajectoryWriter` preallocates a file for the whole run and
+// maps it into memory. Recording a state is a copy into the mapping; the
+// operating system writes it back to disk in the background. Other programs
+// can map the same file and read the trajectory without copying anything, see
+// `TrajectoryReader`.
+//
+// The file is a fixed-size header followed by the records. A record is the
+// time `t` followed by the `n_vars` components of the state. All numbers are
+// stored in native byte order.
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+
+/// The header of a trajectory file, exactly 64 bytes.
+struct TrajectoryHeader {
+  static constexpr char expected_magic[8]
+      = {'O', 'D', 'E', 'T', 'R', 'A', 'J', '1'};
+
+  /// Only 64-bit floating point numbers, for now.
+  static constexpr std::uint64_t dtype_float64 = 1;
+
+  char magic[8];
+
+  /// Offset in bytes of the first record.
+  std::uint64_t header_size;
+
+  std::uint64_t dtype;
+  std::uint64_t n_vars;
+
+  /// Distance in bytes between two consecutive records.
+  std::uint64_t stride;
+
+  /// Number of records the file has room for.
+  std::uint64_t capacity;
+
+  /// Number of records written so far.
+  std::uint64_t n_records;
+
+  std::uint64_t reserved = 0;
+};
+
+static_assert(sizeof(TrajectoryHeader) == 64);
+
+/// Upper bound on the number of records `solve_ode` produces when recording
+/// every `every`-th step.
+inline std::size_t
+trajectory_capacity(double T, double dt, std::size_t every = 1) {
+  // `solve_ode` may take one step more than `T / dt` due to rounding; and
+  // records the initial state.
+  return (std::size_t(std::ceil(T / dt)) + 1) / every + 1;
+}
+
+/// Records every `every`-th step of `solve_ode` in a memory mapped file.
+class TrajectoryWriter : public Observer {
+public:
+  TrajectoryWriter(const std::string &filename,
+                   std::size_t n_vars,
+                   std::size_t capacity,
+                   std::size_t every = 1)
+      : file(MappedFile::create(filename,
+                                sizeof(TrajectoryHeader)
+                                    + capacity * record_size(n_vars))),
+        every(every) {
+    if (every == 0) {
+      throw std::invalid_argument("TrajectoryWriter: `every` must be > 0.");
+    }
+
+    auto &h = header();
+    std::memcpy(h.magic, TrajectoryHeader::expected_magic, sizeof(h.magic));
+    h.header_size = sizeof(TrajectoryHeader);
+    h.dtype = TrajectoryHeader::dtype_float64;
+    h.n_vars = n_vars;
+    h.stride = record_size(n_vars);
+    h.capacity = capacity;
+    h.n_records = 0;
+  }
+
+  void operator()(std::size_t step, double t, Span<const double> y) override {
+    if (step % every != 0) {
+      return;
+    }
+
+    auto &h = header();
+    if (h.n_records == h.capacity) {
+      throw std::length_error("TrajectoryWriter: the file is full.");
+    }
+
+    if (y.size() != h.n_vars) {
+      throw std::invalid_argument("TrajectoryWriter: wrong number of vars.");
+    }
+
+    auto *record = reinterpret_cast<double *>(
+        static_cast<char *>(file.data()) + h.header_size
+        + h.n_records * h.stride);
+
+    record[0] = t;
+    std::memcpy(record + 1, y.data(), y.size() * sizeof(double));
+
+    // Only count the record once it's complete.
+    h.n_records += 1;
+  }
+
+  std::size_t n_records() const { return header().n_records; }
+
+private:
+  static std::size_t record_size(std::size_t n_vars) {
+    return (n_vars + 1) * sizeof(double);
+  }
+
+  TrajectoryHeader &header() {
+    return *static_cast<TrajectoryHeader *>(file.data());
+  }
+
+  const TrajectoryHeader &header() const {
+    return *static_cast<const TrajectoryHeader *>(file.data());
+  }
+
+  MappedFile file;
+  std::size_t every;
+};
+
+/// Zero-copy read access to a trajectory file.
+class TrajectoryReader {
+public:
+  explicit TrajectoryReader(const std::string &filename)
+      : file(MappedFile::open_read_only(filename)) {
+    if (file.size() < sizeof(TrajectoryHeader)) {
+      throw std::runtime_error("TrajectoryReader: file too small.");
+    }
+
+    const auto &h = header();
+    if (std::memcmp(h.magic, TrajectoryHeader::expected_magic, sizeof(h.magic))
+        != 0) {
+      throw std::runtime_error("TrajectoryReader: not a trajectory file.");
+    }
+
+    if (h.dtype != TrajectoryHeader::dtype_float64) {
+      throw std::runtime_error("TrajectoryReader: unsupported dtype.");
+    }
+
+    // The records are read in place as `double`s.
+    if (h.header_size < sizeof(TrajectoryHeader)
+        || h.header_size % alignof(double) != 0) {
+      throw std::runtime_error("TrajectoryReader: invalid header size.");
+    }
+
+    constexpr auto max_size = std::numeric_limits<std::uint64_t>::max();
+    if (h.n_vars > max_size / sizeof(double) - 1
+        || h.stride < (h.n_vars + 1) * sizeof(double)
+        || h.stride % alignof(double) != 0) {
+      throw std::runtime_error("TrajectoryReader: invalid stride.");
+    }
+
+    if (h.n_records > h.capacity) {
+      throw std::runtime_error("TrajectoryReader: more records than room.");
+    }
+
+    if (h.capacity > (max_size - h.header_size) / h.stride
+        || file.size() < h.header_size + h.capacity * h.stride) {
+      throw std::runtime_error("TrajectoryReader: truncated file.");
+    }
+  }
+
+  std::size_t n_vars() const { return header().n_vars; }
+  std::size_t n_records() const { return header().n_records; }
+
+  /// The time of record `k < n_records()`.
+  double time(std::size_t k) const { return record(k)[0]; }
+
+  /// The `n_vars` components of the state of record `k < n_records()`.
+  const double *state(std::size_t k) const { return record(k) + 1; }
+
+private:
+  const double *record(std::size_t k) const {
+    const auto &h = header();
+    assert(k < h.n_records);
+    return reinterpret_cast<const double *>(
+        static_cast<const char *>(file.data()) + h.header_size
+        + k * h.stride);
+  }
+
+  const TrajectoryHeader &header() const {
+    return *static_cast<const TrajectoryHeader *>(file.data());
+  }
+
+  MappedFile file;
+};
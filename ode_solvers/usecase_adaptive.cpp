@@ -0,0 +1,84 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_adaptive
+//
+// Topic: Fixed step Forward Euler vs. adaptive Dormand-Prince at equal
+// accuracy.
+//
+// Finally, a RHS which returns NaN part way through: the adaptive driver must
+// give up with an exception rather than retry the same step forever.
+
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include "counting_rhs.hpp"
+#include "dormand_prince.hpp"
+#include "exp_problem.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "solve_ode_adaptive.hpp"
+#include "span.hpp"
+
+// dy/dt = -2 y until `t = 0.5`, then NaN; e.g. a model evaluated outside of
+// its domain.
+class NaNAfterRHS : public RHS {
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dydt[i] = t < 0.5 ? -2.0 * y[i] : nan;
+    }
+  }
+};
+
+int main() {
+  double T = 1.0;
+  auto y0 = ic();
+  auto y_exact = soln(T);
+
+  std::cout << "Forward Euler:\n";
+  for (double dt : {1e-2, 1e-3, 1e-4, 1e-5}) {
+    auto rhs = std::make_shared<CountingRHS>(std::make_shared<ExpRHS>());
+    auto rk_step = ForwardEulerStep(rhs);
+
+    auto y1 = solve_ode(rk_step, y0, T, dt);
+    std::cout << "  dt = " << dt << ": error = " << max_error(y1, y_exact)
+              << ", RHS evals = " << rhs->count() << "\n";
+  }
+
+  std::cout << "Dormand-Prince 5(4):\n";
+  for (double tol : {1e-3, 1e-5, 1e-7, 1e-9}) {
+    auto rhs = std::make_shared<CountingRHS>(std::make_shared<ExpRHS>());
+    auto rk_step = DormandPrinceStep(rhs);
+
+    auto options = AdaptiveOptions{};
+    options.atol = tol;
+    options.rtol = tol;
+
+    auto stats = AdaptiveStats{};
+    auto y1 = solve_ode_adaptive(rk_step, y0, T, options, stats);
+    std::cout << "  tol = " << tol << ": error = " << max_error(y1, y_exact)
+              << ", accepted = " << stats.n_accepted
+              << ", rejected = " << stats.n_rejected
+              << ", RHS evals = " << rhs->count() << "\n";
+  }
+
+  std::cout << "RHS which returns NaN after t = 0.5:\n";
+  auto stats = AdaptiveStats{};
+  try {
+    auto rk_step = DormandPrinceStep(std::make_shared<NaNAfterRHS>());
+    solve_ode_adaptive(rk_step, y0, T, AdaptiveOptions{}, stats);
+
+    std::cerr << "  NaN went unnoticed.\n";
+    return 1;
+  } catch (const std::runtime_error &e) {
+    std::cout << "  " << e.what() << " (accepted = " << stats.n_accepted
+              << ", rejected = " << stats.n_rejected << ")\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,253 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_autodiff
+//
+// Topic: Exact Jacobians by forward-mode AD, with colored sweeps.
+//
+// First, the derivatives of `Dual` are checked against the known ones, the
+// program fails if they differ by more than rounding. Then the Jacobian of a
+// reaction-diffusion RHS on a periodic grid, written once for any scalar, is
+// computed by finite differences, by dense AD and by colored AD; and compared
+// to the exact one. Finally, Backward Euler is run with finite difference and
+// with AD Jacobians.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "autodiff.hpp"
+#include "counting_rhs.hpp"
+#include "dense_matrix.hpp"
+#include "implicit.hpp"
+#include "rhs.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+double elapsed_seconds(std::chrono::steady_clock::time_point start) {
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+// dy_i/dt = d (y_{i-1} - 2 y_i + y_{i+1}) + y_i^2 (1 - y_i) - 0.1 sin(y_i),
+// periodic. Generic in the scalar, i.e. usable with `double` and `Dual`.
+struct ReactionDiffusion {
+  double d;
+
+  template <class Scalar>
+  void operator()(Span<Scalar> dydt, Span<const Scalar> y, double) const {
+    using std::sin;
+
+    std::size_t n = y.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      const Scalar &left = y[i == 0 ? n - 1 : i - 1];
+      const Scalar &right = y[i == n - 1 ? 0 : i + 1];
+      dydt[i] = d * (left - 2.0 * y[i] + right) + y[i] * y[i] * (1.0 - y[i])
+                - 0.1 * sin(y[i]);
+    }
+  }
+};
+
+// The same, hiding its Jacobian, i.e. forcing finite differences.
+class FiniteDifferenceRHS : public RHS {
+public:
+  explicit FiniteDifferenceRHS(ReactionDiffusion f) : f(f) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    f(dydt, y, t);
+  }
+
+private:
+  ReactionDiffusion f;
+};
+
+// The Jacobian of `ReactionDiffusion`, by hand.
+DenseMatrix exact_jacobian(double d, const std::vector<double> &y) {
+  std::size_t n = y.size();
+  auto dfdy = DenseMatrix(n);
+  dfdy.set_zero();
+  for (std::size_t i = 0; i < n; ++i) {
+    dfdy(i, i) = -2.0 * d + 2.0 * y[i] - 3.0 * y[i] * y[i]
+                 - 0.1 * std::cos(y[i]);
+    dfdy(i, i == 0 ? n - 1 : i - 1) += d;
+    dfdy(i, i == n - 1 ? 0 : i + 1) += d;
+  }
+  return dfdy;
+}
+
+double max_difference(const DenseMatrix &a, const DenseMatrix &b) {
+  double diff = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    for (std::size_t j = 0; j < a.size(); ++j) {
+      diff = std::max(diff, std::abs(a(i, j) - b(i, j)));
+    }
+  }
+  return diff;
+}
+
+double max_difference(const std::vector<double> &a,
+                      const std::vector<double> &b) {
+  double diff = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    diff = std::max(diff, std::abs(a[i] - b[i]));
+  }
+  return diff;
+}
+
+// Returns `true` if the derivatives of `Dual` agree with the known ones.
+bool check_dual() {
+  using D = Dual<2>;
+
+  // `x` in direction 0, `y` in direction 1.
+  double x = 0.7;
+  double y = 1.3;
+  auto dx = D(x, {1.0, 0.0});
+  auto dy = D(y, {0.0, 1.0});
+
+  struct Case {
+    std::string label;
+    D f;
+    double df_dx;
+    double df_dy;
+  };
+
+  auto cases = std::vector<Case>{
+      {"x * y", dx * dy, y, x},
+      {"x / y", dx / dy, 1.0 / y, -x / (y * y)},
+      {"2 - x + y", 2.0 - dx + dy, -1.0, 1.0},
+      {"1 / x", 1.0 / dx, -1.0 / (x * x), 0.0},
+      {"sqrt(x)", sqrt(dx), 0.5 / std::sqrt(x), 0.0},
+      {"exp(x y)", exp(dx * dy), y * std::exp(x * y), x * std::exp(x * y)},
+      {"log(y)", log(dy), 0.0, 1.0 / y},
+      {"sin(x)", sin(dx), std::cos(x), 0.0},
+      {"cos(x)", cos(dx), -std::sin(x), 0.0},
+      {"tanh(y)", tanh(dy), 1.0 - std::pow(std::tanh(y), 2), 0.0},
+      {"pow(x, 2.5)", pow(dx, 2.5), 2.5 * std::pow(x, 1.5), 0.0},
+      {"abs(-x)", abs(-dx), 1.0, 0.0}};
+
+  // `tanh(y)` is in direction 1.
+  std::swap(cases[9].df_dx, cases[9].df_dy);
+
+  for (const auto &c : cases) {
+    double err = std::max(std::abs(c.f.tangent[0] - c.df_dx),
+                          std::abs(c.f.tangent[1] - c.df_dy));
+    if (err > 1e-15) {
+      std::cerr << c.label << ": error = " << err << "\n";
+      return false;
+    }
+  }
+
+  if (std::numeric_limits<D>::epsilon().value
+      != std::numeric_limits<double>::epsilon()) {
+    std::cerr << "numeric_limits: wrong epsilon.\n";
+    return false;
+  }
+
+  return true;
+}
+
+// Time `jacobian` of `rhs` at `y`, in microseconds.
+double time_jacobian(const RHS &rhs,
+                     DenseMatrix &dfdy,
+                     const std::vector<double> &y) {
+  std::size_t n_repeats = 100;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t r = 0; r < n_repeats; ++r) {
+    rhs.jacobian(dfdy, y, 0.0);
+  }
+  return elapsed_seconds(start) / double(n_repeats) * 1e6;
+}
+
+int main() {
+  if (!check_dual()) {
+    return 1;
+  }
+  std::cout << "Dual derivatives agree with the known ones\n\n";
+
+  std::size_t n = 200;
+  auto f = ReactionDiffusion{1.0e4};
+  double pi = std::acos(-1.0);
+  auto y = std::vector<double>(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    y[i] = 0.5 + 0.4 * std::sin(2.0 * pi * double(i) / double(n));
+  }
+  auto exact = exact_jacobian(f.d, y);
+
+  // The columns `j` and `j + 2` share the row `j + 1`, i.e. three colors
+  // for a tridiagonal Jacobian. It's periodic and `n` isn't a multiple of
+  // three, greedy coloring then needs five.
+  using ColoredRHS = AutoDiffRHS<ReactionDiffusion, 5>;
+  auto dense = AutoDiffRHS<ReactionDiffusion>(f);
+  auto sparsity = periodic_band_sparsity(n, 1, 1);
+  auto colored = ColoredRHS(f, sparsity);
+
+  auto dfdy = DenseMatrix{};
+  std::cout << n << " unknowns, Jacobian:\n";
+
+  {
+    auto workspace = Workspace{};
+    std::size_t batch = std::min(n, finite_difference_batch_size) * n;
+    auto fd_rhs = FiniteDifferenceRHS(f);
+    auto start = std::chrono::steady_clock::now();
+    finite_difference_jacobian(dfdy,
+                               fd_rhs,
+                               y,
+                               0.0,
+                               workspace.vector(0, n),
+                               workspace.vector(1, batch),
+                               workspace.vector(2, batch));
+    double micro_seconds = elapsed_seconds(start) * 1e6;
+    std::cout << "  finite differences: error = "
+              << max_difference(dfdy, exact) << ", " << n + 1
+              << " evaluations, " << micro_seconds << " us\n";
+  }
+
+  double micro_seconds = time_jacobian(dense, dfdy, y);
+  std::cout << "  dense AD, Dual<8>:  error = " << max_difference(dfdy, exact)
+            << ", " << dense.n_sweeps(n) << " sweeps, " << micro_seconds
+            << " us\n";
+
+  micro_seconds = time_jacobian(colored, dfdy, y);
+  std::cout << "  colored AD, Dual<5>: error = "
+            << max_difference(dfdy, exact) << ", " << colored.n_sweeps(n)
+            << " sweeps, " << micro_seconds << " us\n";
+
+  // Backward Euler with a fresh Jacobian every step, as if it changed too
+  // quickly to be reused.
+  double T = 0.25;
+  double dt = 1.0 / 64.0;
+  auto run = [&](const std::string &label, std::shared_ptr<RHS> rhs) {
+    auto counting = std::make_shared<CountingRHS>(rhs);
+    auto options = NewtonOptions{};
+    options.max_jacobian_age = 1;
+    auto step = BackwardEulerStep(counting, options);
+
+    auto workspace = Workspace{};
+    auto start = std::chrono::steady_clock::now();
+    auto y1 = solve_ode(step, y, T, dt, workspace);
+    double seconds = elapsed_seconds(start);
+
+    const auto &stats = step.newton_stats(workspace);
+    std::cout << "  " << label << ": Jacobians = " << stats.n_jacobians
+              << ", RHS evals = " << counting->count() << ", " << seconds * 1e3
+              << " ms\n";
+    return y1;
+  };
+
+  std::cout << "\nBackward Euler, a Jacobian per step:\n";
+  auto y_fd
+      = run("finite differences", std::make_shared<FiniteDifferenceRHS>(f));
+  auto y_ad
+      = run("colored AD        ", std::make_shared<ColoredRHS>(f, sparsity));
+  std::cout << "  difference of the solutions: " << max_difference(y_fd, y_ad)
+            << "\n";
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_butcher_tableau
+//
+// Topic: Many explicit schemes from one generic step.
+//
+// Every scheme below is `ExplicitRKStep` with a different `constexpr` Butcher
+// tableau. First, the order of each is confirmed. Then the generic forward
+// Euler is timed against the hand-written `ForwardEulerStep`; it should be
+// no slower. Finally, RK4 is timed against the low-storage RK4. The latter
+// has one more stage, but fewer vectors to stream through memory, which wins
+// once the state doesn't fit in cache.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "butcher_tableau.hpp"
+#include "exp_problem.hpp"
+#include "low_storage_rk.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+
+template <class Tableau>
+void convergence(const std::string &label) {
+  double T = 1.0;
+  auto y_exact = soln(T);
+  auto rk_step = ExplicitRKStep<Tableau>(std::make_shared<ExpRHS>());
+
+  std::cout << label << " (order " << rk_step.order() << "):\n";
+  double err_prev = 0.0;
+  for (double dt : {1.0 / 16.0, 1.0 / 32.0, 1.0 / 64.0}) {
+    double err = max_error(solve_ode(rk_step, ic(), T, dt), y_exact);
+
+    std::cout << "  dt = " << dt << ": error = " << err;
+    if (err_prev > 0.0) {
+      std::cout << ", rate = " << std::log2(err_prev / err);
+    }
+    std::cout << "\n";
+    err_prev = err;
+  }
+}
+
+// Seconds per step on `n_vars` unknowns, after a warm-up step.
+double seconds_per_step(const RKStep &rk_step, std::size_t n_vars) {
+  std::size_t n_steps = 100;
+  double dt = 1.0 / 1024.0;
+
+  auto y0 = std::vector<double>(n_vars, 1.0);
+  solve_ode(rk_step, y0, dt, dt);
+
+  auto start = std::chrono::steady_clock::now();
+  solve_ode(rk_step, y0, n_steps * dt, dt);
+  auto stop = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double>(stop - start).count() / n_steps;
+}
+
+int main() {
+  convergence<EulerTableau>("Forward Euler");
+  convergence<HeunTableau>("Heun");
+  convergence<SSPRK3Tableau>("SSP-RK3");
+  convergence<RK4Tableau>("RK4");
+  convergence<RK38Tableau>("3/8-rule");
+
+  std::size_t n_vars = std::size_t(1) << 22;
+  auto rhs = std::make_shared<ExpRHS>();
+
+  std::cout << "\nTime per step, " << n_vars << " unknowns:\n";
+  std::cout << "  Forward Euler, hand-written: "
+            << seconds_per_step(ForwardEulerStep(rhs), n_vars) << " s\n";
+  std::cout << "  Forward Euler, tableau:      "
+            << seconds_per_step(ExplicitRKStep<EulerTableau>(rhs), n_vars)
+            << " s\n";
+
+  // Five stages and two registers vs. four stages and six registers.
+  auto low_storage = LowStorageRKStep(rhs, carpenter_kennedy_rk4_tableau());
+  std::cout << "  RK4, low-storage:            "
+            << seconds_per_step(low_storage, n_vars) << " s\n";
+  std::cout << "  RK4, tableau:                "
+            << seconds_per_step(RK4Step(rhs), n_vars) << " s\n";
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_ensemble
+//
+// Topic: Batching the Monte Carlo loop of `polymorphism/usecase_odes.cpp`.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+#include "ensemble.hpp"
+#include "exp_problem.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+
+double elapsed_seconds(std::chrono::steady_clock::time_point start) {
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+// The loop from the tutorial: one member at a time.
+double one_by_one(std::size_t n_samples, double T, double dt) {
+  auto start = std::chrono::steady_clock::now();
+
+  double err = 0.0;
+  for (std::size_t s = 0; s < n_samples; ++s) {
+    auto y0 = ic();
+    auto rhs = std::make_shared<ExpRHS>();
+    auto rk_step = ForwardEulerStep(rhs);
+
+    auto y1 = solve_ode(rk_step, y0, T, dt);
+    err = std::max(err, max_error(y1, soln(T)));
+  }
+
+  double t_wall = elapsed_seconds(start);
+  std::cout << "one by one:      " << n_samples / t_wall
+            << " members/s, error = " << err << "\n";
+  return t_wall;
+}
+
+// The same samples, `n_members` at a time.
+double batched(std::size_t n_samples,
+               std::size_t n_members,
+               double T,
+               double dt) {
+  auto start = std::chrono::steady_clock::now();
+
+  std::size_t n_vars = ic().size();
+  auto rhs = std::make_shared<ExpRHS>();
+  auto rk_step = ForwardEulerStep(rhs);
+
+  double err = 0.0;
+  for (std::size_t s = 0; s < n_samples; s += n_members) {
+    auto y0 = Ensemble(n_vars, n_members);
+    for (std::size_t k = 0; k < n_members; ++k) {
+      y0.set_member(k, ic());
+    }
+
+    auto y1 = solve_ode(rk_step, std::move(y0), T, dt);
+    for (std::size_t k = 0; k < n_members; ++k) {
+      err = std::max(err, max_error(y1.member(k), soln(T)));
+    }
+  }
+
+  double t_wall = elapsed_seconds(start);
+  std::cout << "batches of " << n_members << ": " << n_samples / t_wall
+            << " members/s, error = " << err << "\n";
+  return t_wall;
+}
+
+int main() {
+  double T = 1.0;
+  double dt = 0.01;
+  std::size_t n_samples = 1 << 16;
+
+  one_by_one(n_samples, T, dt);
+  for (std::size_t n_members : {1, 4, 16, 64, 256, 1024}) {
+    batched(n_samples, n_members, T, dt);
+  }
+
+  return 0;
+}
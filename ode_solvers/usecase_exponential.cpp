@@ -0,0 +1,82 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_exponential
+//
+// Topic: Exponential integrators, exact for the linear part of the RHS.
+//
+// First, `ExpRHS` is linear; a single exponential step over the whole
+// interval reproduces `soln(T)` up to rounding, while Forward Euler isn't even
+// stable for such a step. Second, the stiff Prothero-Robinson problem of
+// `usecase_stiff` has a stiff linear part and a smooth rest. The exponential
+// schemes converge at their order with steps ten thousand times larger than
+// Forward Euler needs for stability, without a Jacobian or a linear solve.
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "counting_rhs.hpp"
+#include "exp_problem.hpp"
+#include "exponential.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "stiff_problem.hpp"
+
+template <class Step>
+void convergence(const std::string &label,
+                 std::shared_ptr<RHS> stiff_rhs,
+                 const std::vector<double> &y0,
+                 const std::vector<double> &y_exact,
+                 double T) {
+  std::cout << label << ":\n";
+  double err_prev = 0.0;
+  // Powers of two, such that `solve_ode` ends exactly at `T`.
+  for (double dt : {1.0 / 8.0, 1.0 / 16.0, 1.0 / 32.0, 1.0 / 64.0}) {
+    auto rhs = std::make_shared<CountingRHS>(stiff_rhs);
+    double err = max_error(solve_ode(Step(rhs), y0, T, dt), y_exact);
+
+    std::cout << "  dt = " << dt << ": error = " << err;
+    if (err_prev > 0.0) {
+      std::cout << ", rate = " << std::log2(err_prev / err);
+    }
+    std::cout << ", RHS evals = " << rhs->count() << "\n";
+    err_prev = err;
+  }
+}
+
+int main() {
+  {
+    double T = 1.0;
+    auto rhs = std::make_shared<ExpRHS>();
+
+    std::cout << "dy/dt = -2 y, a single step of size " << T << ":\n";
+    std::cout << "  Forward Euler:      error = "
+              << max_error(solve_ode(ForwardEulerStep(rhs), ic(), T, T),
+                           soln(T))
+              << "\n";
+    std::cout << "  Exponential Euler:  error = "
+              << max_error(solve_ode(ExponentialEulerStep(rhs), ic(), T, T),
+                           soln(T))
+              << "\n";
+    std::cout << "  ETD2RK:             error = "
+              << max_error(solve_ode(ETDRK2Step(rhs), ic(), T, T), soln(T))
+              << "\n\n";
+  }
+
+  std::size_t n_vars = 10;
+  double T = 1.0;
+  auto lambda = stiff_decay_rates(n_vars, 1e6);
+  auto y0 = std::vector<double>(n_vars, 2.0);
+  auto y_exact = stiff_soln(lambda, y0, T);
+  auto stiff_rhs = std::make_shared<ProtheroRobinsonRHS>(lambda);
+
+  std::cout << "Prothero-Robinson, max(lambda) = 1e6, Forward Euler needs "
+               "dt < 2e-6.\n";
+  convergence<ExponentialEulerStep>(
+      "Exponential Euler", stiff_rhs, y0, y_exact, T);
+  convergence<ETDRK2Step>("ETD2RK", stiff_rhs, y0, y_exact, T);
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_imex
+//
+// Topic: Implicit in the stiff part only.
+//
+// Fisher-KPP on a periodic grid, a method of lines:
+//
+//   dy_i/dt = D (y_{i-1} - 2 y_i + y_{i+1}) / h^2 + r y_i (1 - y_i).
+//
+// The diffusion is linear and stiff, the reaction nonlinear and slow. RK4 on
+// the whole RHS is unstable unless `dt < 2.78 h^2 / (4 D)`. Backward Euler on
+// the whole RHS is stable, but Newton needs the Jacobian of the reaction,
+// which changes as the solution does. The IMEX schemes take steps of the size
+// the reaction allows, and factorize the constant Jacobian of the diffusion
+// once.
+//
+// ARK3(2)4L[2]SA is third order in the non-stiff limit. Here, the diffusion
+// is stiff and its stages aren't resolved; the measured rate is about 2.75,
+// not 3.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "butcher_tableau.hpp"
+#include "counting_rhs.hpp"
+#include "dense_matrix.hpp"
+#include "imex.hpp"
+#include "implicit.hpp"
+#include "rhs.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+// `D / h^2` times the periodic second difference; stiff and linear.
+class DiffusionRHS : public RHS {
+public:
+  explicit DiffusionRHS(double d) : d(d) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double /* t */) const override {
+    std::size_t n = y.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      double left = y[i == 0 ? n - 1 : i - 1];
+      double right = y[i == n - 1 ? 0 : i + 1];
+      dydt[i] = d * (left - 2.0 * y[i] + right);
+    }
+  }
+
+  bool do_jacobian(DenseMatrix &dfdy,
+                   Span<const double> y,
+                   double /* t */) const override {
+    std::size_t n = y.size();
+    dfdy.resize(n);
+    dfdy.set_zero();
+    for (std::size_t i = 0; i < n; ++i) {
+      dfdy(i, i) = -2.0 * d;
+      dfdy(i, i == 0 ? n - 1 : i - 1) += d;
+      dfdy(i, i == n - 1 ? 0 : i + 1) += d;
+    }
+    return true;
+  }
+
+private:
+  double d;
+};
+
+// `r y (1 - y)`; non-stiff and nonlinear.
+class ReactionRHS : public RHS {
+public:
+  explicit ReactionRHS(double r) : r(r) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double /* t */) const override {
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dydt[i] = r * y[i] * (1.0 - y[i]);
+    }
+  }
+
+private:
+  double r;
+};
+
+// Both parts, for the schemes which don't split.
+class FisherKPPRHS : public RHS {
+public:
+  FisherKPPRHS(double d, double r) : d(d), r(r) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double /* t */) const override {
+    std::size_t n = y.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      double left = y[i == 0 ? n - 1 : i - 1];
+      double right = y[i == n - 1 ? 0 : i + 1];
+      dydt[i] = d * (left - 2.0 * y[i] + right) + r * y[i] * (1.0 - y[i]);
+    }
+  }
+
+private:
+  double d;
+  double r;
+};
+
+// Infinite, if `a` blew up.
+double max_difference(const std::vector<double> &a,
+                      const std::vector<double> &b) {
+  double diff = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (!std::isfinite(a[i])) {
+      return std::numeric_limits<double>::infinity();
+    }
+    diff = std::max(diff, std::abs(a[i] - b[i]));
+  }
+  return diff;
+}
+
+void print_newton(const NewtonStats &stats) {
+  std::cout << ", Newton iterations = " << stats.n_iterations
+            << ", Jacobians = " << stats.n_jacobians
+            << ", LU = " << stats.n_factorizations << "\n";
+}
+
+template <class Step>
+void convergence(const std::string &label,
+                 const SplitRHS &rhs,
+                 const std::vector<double> &y0,
+                 const std::vector<double> &y_ref,
+                 double T) {
+  std::cout << label << ":\n";
+  double err_prev = 0.0;
+  for (double dt : {1.0 / 8.0, 1.0 / 16.0, 1.0 / 32.0, 1.0 / 64.0}) {
+    auto workspace = Workspace{};
+    auto step = Step(rhs);
+    double err = max_difference(solve_ode(step, y0, T, dt, workspace), y_ref);
+
+    std::cout << "  dt = " << dt << ": error = " << err;
+    if (err_prev > 0.0) {
+      std::cout << ", rate = " << std::log2(err_prev / err);
+    }
+    print_newton(step.newton_stats(workspace));
+    err_prev = err;
+  }
+}
+
+int main() {
+  std::size_t n = 200;
+  double h = 1.0 / double(n);
+  double d = 0.1 / (h * h);
+  double r = 4.0;
+  double T = 1.0;
+
+  // A bump which spreads and saturates at `y = 1`.
+  double pi = std::acos(-1.0);
+  auto y0 = std::vector<double>(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    double x = double(i) * h;
+    y0[i] = 0.1 * std::exp(-20.0 * std::pow(std::sin(pi * x), 2));
+  }
+
+  auto rhs = SplitRHS{std::make_shared<ReactionRHS>(r),
+                      std::make_shared<DiffusionRHS>(d)};
+
+  // The reference, with a step size far below the one of interest.
+  auto y_ref = solve_ode(ARK324Step(rhs), y0, T, 1.0 / 4096.0);
+
+  std::cout << "stiffness: 4 D / h^2 = " << 4.0 * d
+            << ", RK4 needs dt < " << 2.78 / (4.0 * d) << "\n\n";
+
+  convergence<IMEXEulerStep>("IMEX Euler, order 1", rhs, y0, y_ref, T);
+  convergence<ARK324Step>(
+      "ARK3(2)4L[2]SA, order 3, reduced by the stiff diffusion",
+      rhs,
+      y0,
+      y_ref,
+      T);
+
+  auto full_rhs = std::make_shared<CountingRHS>(
+      std::make_shared<FisherKPPRHS>(d, r));
+
+  std::cout << "\nWhole RHS:\n";
+  double dt = 1.0 / 16.0;
+  double err = max_difference(solve_ode(RK4Step(full_rhs), y0, T, dt), y_ref);
+  std::cout << "  RK4, dt = " << dt << ": error = " << err << "\n";
+
+  auto workspace = Workspace{};
+  auto backward_euler = BackwardEulerStep(full_rhs);
+  err = max_difference(solve_ode(backward_euler, y0, T, dt, workspace), y_ref);
+  std::cout << "  Backward Euler, dt = " << dt << ": error = " << err;
+  print_newton(backward_euler.newton_stats(workspace));
+
+  return 0;
+}
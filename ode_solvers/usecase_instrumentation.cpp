@@ -0,0 +1,85 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_instrumentation
+//
+// Topic: Per-component cost breakdown through the non-virtual interface.
+//
+// None of the steps or RHS below know they're being measured. The
+// instrumentation lives in the public methods of `RKStep`, `RHS` and
+// `RangeRHS`, see `instrumentation.hpp`. Without the `#define` it compiles to
+// nothing.
+
+#define ODE_SOLVERS_INSTRUMENTATION
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "dormand_prince.hpp"
+#include "exp_problem.hpp"
+#include "implicit.hpp"
+#include "instrumentation.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "solve_ode_adaptive.hpp"
+#include "stiff_problem.hpp"
+#include "thread_pool.hpp"
+#include "threaded.hpp"
+
+void print_instrumentation() {
+  std::cout << std::left << std::setw(28) << "implementation"
+            << std::setw(20) << "operation" << std::right << std::setw(10)
+            << "calls" << std::setw(12) << "seconds" << std::setw(12)
+            << "GB/s"
+            << "\n";
+
+  for (const auto &r : instrumentation_records()) {
+    std::cout << std::left << std::setw(28) << r.implementation
+              << std::setw(20) << r.operation << std::right << std::setw(10)
+              << r.n_calls << std::setw(12) << r.seconds << std::setw(12)
+              << double(r.bytes) / r.seconds * 1e-9 << "\n";
+  }
+  std::cout << "\n";
+}
+
+int main() {
+  double T = 1.0;
+
+  {
+    // A large state, the RHS evaluated by the thread pool.
+    std::size_t n_vars = 1 << 20;
+    auto pool = std::make_shared<ThreadPool>();
+    auto rhs = std::make_shared<ThreadedRHS>(std::make_shared<ExpRHS>(),
+                                             ThreadedExecution(pool));
+
+    auto y0 = std::vector<double>(n_vars, 1.0);
+    solve_ode(ForwardEulerStep(rhs), y0, T, 1e-2);
+
+    auto options = AdaptiveOptions{};
+    options.atol = 1e-8;
+    options.rtol = 1e-8;
+    auto stats = AdaptiveStats{};
+    solve_ode_adaptive(DormandPrinceStep(rhs), y0, T, options, stats);
+
+    std::cout << "Large non-stiff problem, " << n_vars << " unknowns:\n";
+    print_instrumentation();
+  }
+
+  reset_instrumentation();
+
+  {
+    // A small stiff problem, where the dense linear algebra dominates.
+    std::size_t n_vars = 100;
+    auto lambda = stiff_decay_rates(n_vars, 1e6);
+    auto rhs = std::make_shared<ProtheroRobinsonRHS>(lambda);
+
+    auto y0 = std::vector<double>(n_vars, 2.0);
+    solve_ode(BDFStep(rhs), y0, T, 1e-3);
+
+    std::cout << "Small stiff problem, " << n_vars << " unknowns:\n";
+    print_instrumentation();
+  }
+
+  return 0;
+}
@@ -0,0 +1,161 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_jfnk
+//
+// Topic: Implicit steps without a Jacobian, for large systems.
+//
+// A method of lines for a stiff reaction-diffusion equation on a periodic
+// grid:
+//
+//   dy_i/dt = d (y_{i-1} - 2 y_i + y_{i+1}) - lambda_i (y_i - cos(t)) - sin(t)
+//
+// i.e. Prothero-Robinson plus diffusion. First, on a small grid, Backward
+// Euler by JFNK is compared to Backward Euler with the dense Newton solver,
+// with and without preconditioner. Then JFNK takes four steps with 2^20
+// unknowns, for which the dense Jacobian alone would need 8 TiB. POSIX only,
+// because of `getrusage`.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "implicit.hpp"
+#include "jfnk.hpp"
+#include "rhs.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "stiff_problem.hpp"
+#include "workspace.hpp"
+
+class ReactionDiffusionRHS : public RHS {
+public:
+  ReactionDiffusionRHS(std::vector<double> lambda, double d)
+      : lambda(std::move(lambda)), d(d) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    double cos_t = std::cos(t);
+    double sin_t = std::sin(t);
+
+    std::size_t n = y.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      double left = y[i == 0 ? n - 1 : i - 1];
+      double right = y[i == n - 1 ? 0 : i + 1];
+      dydt[i] = d * (left - 2.0 * y[i] + right)
+                - lambda[i] * (y[i] - cos_t) - sin_t;
+    }
+  }
+
+  // The diagonal of the Jacobian; the coupling to the neighbours is part of
+  // `N`.
+  bool do_linear_part(Span<double> diagonal, double /* t */) const override {
+    for (std::size_t i = 0; i < diagonal.size(); ++i) {
+      diagonal[i] = -2.0 * d - lambda[i];
+    }
+    return true;
+  }
+
+private:
+  std::vector<double> lambda;
+  double d;
+};
+
+// Peak resident memory of the process in bytes.
+double peak_memory() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  // Linux reports KiB.
+  return double(usage.ru_maxrss) * 1024.0;
+}
+
+std::vector<double> initial_condition(std::size_t n) {
+  double pi = std::acos(-1.0);
+  auto y0 = std::vector<double>(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    y0[i] = 1.0 + std::sin(2.0 * pi * double(i) / double(n));
+  }
+  return y0;
+}
+
+double max_difference(const std::vector<double> &a,
+                      const std::vector<double> &b) {
+  double diff = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    diff = std::max(diff, std::abs(a[i] - b[i]));
+  }
+  return diff;
+}
+
+void print_stats(const JFNKStats &stats, double n_steps) {
+  std::cout << "Newton/step = " << stats.n_newton_iterations / n_steps
+            << ", GMRES/step = " << stats.n_krylov_iterations / n_steps
+            << ", RHS evals/step = " << stats.n_rhs_evals / n_steps << "\n";
+}
+
+int main() {
+  double d = 100.0;
+  double dt = 1.0 / 64.0;
+
+  {
+    std::size_t n = 200;
+    double T = 0.25;
+    double n_steps = T / dt;
+    auto rhs = std::make_shared<ReactionDiffusionRHS>(
+        stiff_decay_rates(n, 1e6), d);
+    auto y0 = initial_condition(n);
+
+    auto dense = solve_ode(BackwardEulerStep(rhs), y0, T, dt);
+    std::cout << n << " unknowns, difference to dense Newton:\n";
+
+    auto workspace = Workspace{};
+    auto jfnk = JFNKBackwardEulerStep(rhs);
+    auto y1 = solve_ode(jfnk, y0, T, dt, workspace);
+    std::cout << "  no preconditioner: " << max_difference(y1, dense)
+              << ", ";
+    print_stats(jfnk.jfnk_stats(workspace), n_steps);
+
+    auto diagonal = std::make_shared<DiagonalPreconditioner>(rhs);
+    auto preconditioned = JFNKBackwardEulerStep(rhs, diagonal);
+    y1 = solve_ode(preconditioned, y0, T, dt, workspace);
+    std::cout << "  diagonal:          " << max_difference(y1, dense)
+              << ", ";
+    print_stats(preconditioned.jfnk_stats(workspace), n_steps);
+  }
+
+  {
+    std::size_t n = std::size_t(1) << 20;
+    double T = 4.0 * dt;
+    double n_steps = 4.0;
+    double state_size = double(n) * sizeof(double);
+    double baseline = peak_memory();
+
+    auto rhs = std::make_shared<ReactionDiffusionRHS>(
+        stiff_decay_rates(n, 1e6), d);
+    auto diagonal = std::make_shared<DiagonalPreconditioner>(rhs);
+    auto options = JFNKOptions{};
+    options.krylov_dim = 10;
+    auto jfnk = JFNKBackwardEulerStep(rhs, diagonal, options);
+
+    auto workspace = Workspace{};
+    auto start = std::chrono::steady_clock::now();
+    auto y1 = solve_ode(jfnk, initial_condition(n), T, dt, workspace);
+    auto stop = std::chrono::steady_clock::now();
+
+    std::cout << "\n" << n << " unknowns, diagonal preconditioner:\n  ";
+    print_stats(jfnk.jfnk_stats(workspace), n_steps);
+    std::cout << "  " << std::chrono::duration<double>(stop - start).count()
+              << " s, peak memory = "
+              << (peak_memory() - baseline) / state_size
+              << " x N doubles, the dense Jacobian alone would be "
+              << double(n) << " x N doubles\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_low_storage
+//
+// Topic: Fourth order accuracy in two registers.
+//
+// First, the order of the low-storage schemes is confirmed. Then the peak
+// memory of a large run is measured, in multiples of the size of the state.
+// POSIX only, because of `getrusage`.
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "dormand_prince.hpp"
+#include "exp_problem.hpp"
+#include "low_storage_rk.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "workspace.hpp"
+
+// Peak resident memory of the process in bytes.
+double peak_memory() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  // Linux reports KiB.
+  return double(usage.ru_maxrss) * 1024.0;
+}
+
+void convergence(const std::string &label, const LowStorageTableau &tableau) {
+  double T = 1.0;
+  auto y_exact = soln(T);
+  auto rk_step = LowStorageRKStep(std::make_shared<ExpRHS>(), tableau);
+
+  std::cout << label << ":\n";
+  double err_prev = 0.0;
+  for (double dt : {1.0 / 16.0, 1.0 / 32.0, 1.0 / 64.0, 1.0 / 128.0}) {
+    double err = max_error(solve_ode(rk_step, ic(), T, dt), y_exact);
+
+    std::cout << "  dt = " << dt << ": error = " << err;
+    if (err_prev > 0.0) {
+      std::cout << ", rate = " << std::log2(err_prev / err);
+    }
+    std::cout << "\n";
+    err_prev = err;
+  }
+}
+
+// Peak memory of `solve_ode` in multiples of the size of the state, relative
+// to `baseline`.
+//
+// Note: the peak never decreases, hence the runs must be in order of
+// increasing memory use.
+double peak_registers(const RKStep &rk_step,
+                      std::size_t n_vars,
+                      double baseline) {
+  double state_size = double(n_vars) * sizeof(double);
+
+  {
+    auto workspace = Workspace{};
+    auto y0 = std::vector<double>(n_vars, 1.0);
+    y0 = solve_ode(rk_step, std::move(y0), 4e-3, 1e-3, workspace);
+  }
+
+  return (peak_memory() - baseline) / state_size;
+}
+
+int main() {
+  convergence("Williamson RK3", williamson_rk3_tableau());
+  convergence("Carpenter-Kennedy RK4", carpenter_kennedy_rk4_tableau());
+
+  std::size_t n_vars = std::size_t(1) << 24;
+  auto rhs = std::make_shared<ExpRHS>();
+  double baseline = peak_memory();
+
+  std::cout << "\nPeak memory, " << n_vars << " unknowns:\n";
+  auto low_storage = LowStorageRKStep(rhs, carpenter_kennedy_rk4_tableau());
+  std::cout << "  Carpenter-Kennedy RK4: "
+            << peak_registers(low_storage, n_vars, baseline)
+            << " x N doubles\n";
+
+  std::cout << "  Dormand-Prince:        "
+            << peak_registers(DormandPrinceStep(rhs), n_vars, baseline)
+            << " x N doubles\n";
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_mixed_precision
+//
+// Topic: Throughput vs. accuracy of double, single and mixed precision.
+//
+// A large ensemble of copies of `ic()` is advanced by the fourth order
+// low-storage scheme and compared to `soln(T)`. In single precision the state
+// takes half the memory and a SIMD register holds twice as many unknowns. The
+// price is that the error stalls at the rounding error of `float`, no matter
+// how small `dt`. Mixed precision keeps the state in `float`, but accumulates
+// the stages, including the RHS, in `double`: the RHS reads the `float` state
+// and adds to the `double` increment in one pass, see
+// `RHS::add_scaled_widened`.
+//
+// Hence, it moves less memory than double precision. It's more accurate than
+// single precision only as far as the rounding of the increments and of the
+// RHS matters; the state is still rounded to `float` after every stage.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ensemble.hpp"
+#include "exp_problem.hpp"
+#include "low_storage_rk.hpp"
+#include "rhs.hpp"
+#include "solve_ode.hpp"
+
+template <class Scalar, class Accumulator>
+void run(const std::string &label, std::size_t n_members, double dt) {
+  double T = 1.0;
+  auto rhs = std::make_shared<BasicExpRHS<Accumulator>>();
+  auto rk_step = BasicLowStorageRKStep<Scalar, Accumulator>(
+      rhs, carpenter_kennedy_rk4_tableau());
+
+  auto y0_double = ic();
+  auto y0 = std::vector<Scalar>(y0_double.begin(), y0_double.end());
+
+  auto ensemble = BasicEnsemble<Scalar>(y0.size(), n_members);
+  for (std::size_t k = 0; k < n_members; ++k) {
+    ensemble.set_member(k, y0);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  ensemble = solve_ode(rk_step, std::move(ensemble), T, dt);
+  auto stop = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(stop - start).count();
+
+  double err = 0.0;
+  for (std::size_t k = 0; k < n_members; ++k) {
+    err = std::max(err, max_error(ensemble.member(k), soln(T)));
+  }
+
+  double n_steps = T / dt;
+  double n_unknowns = double(ensemble.data().size());
+  std::cout << "  " << label << ": error = " << err << ", "
+            << seconds / (n_steps * n_unknowns) * 1e9
+            << " ns per unknown and step\n";
+}
+
+int main() {
+  std::size_t n_members = std::size_t(1) << 20;
+
+  for (double dt : {1.0 / 16.0, 1.0 / 64.0, 1.0 / 256.0}) {
+    std::cout << "dt = " << dt << ":\n";
+    run<double, double>("double", n_members, dt);
+    run<float, float>("float ", n_members, dt);
+    run<float, double>("mixed ", n_members, dt);
+  }
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_mlmc
+//
+// Topic: Multilevel Monte Carlo, the expectation for less than one fine solve
+// per sample.
+//
+// The random problem of `usecase_monte_carlo.cpp`: dy/dt = -rate * y with a
+// perturbed initial condition and rate. The quantity of interest is the sum of
+// the components of `y(T)`, its expectation is known exactly. For several
+// target RMSEs, MLMC with Forward Euler is compared to plain Monte Carlo at
+// the finest step size MLMC needed, in steps.
+//
+// Forward Euler is first order, i.e. the variance of `P_l - P_{l - 1}` decays
+// like `dt^2` and the cost per sample grows like `1 / dt`. MLMC then costs
+// `O(rmse^-2)` steps; plain Monte Carlo `O(rmse^-3)`.
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "exp_problem.hpp"
+#include "mlmc.hpp"
+#include "monte_carlo.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solver_context.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+
+// dy/dt = -rate * y. The rate is changed between solves, hence every thread
+// needs its own instance.
+class DecayRHS : public RHS {
+public:
+  void set_rate(double rate) { this->rate = rate; }
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double /* t */) const override {
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dydt[i] = -rate * y[i];
+    }
+  }
+
+private:
+  double rate = 2.0;
+};
+
+// What each thread reuses from one sample to the next.
+struct ThreadState {
+  std::shared_ptr<DecayRHS> rhs = std::make_shared<DecayRHS>();
+  SolverContext context
+      = SolverContext(std::make_shared<ForwardEulerStep>(rhs));
+};
+
+int main() {
+  double T = 1.0;
+  double dt_0 = 1.0 / 4.0;
+
+  // `E[sum_i y0_i * e^(-rate T)]` for `y0_i = ic()_i * (1 + 0.1 N(0, 1))`
+  // and `rate ~ U(1.5, 2.5)`.
+  double exact = 6.0 * (std::exp(-1.5 * T) - std::exp(-2.5 * T)) / T;
+
+  auto pool = ThreadPool();
+  auto states = std::vector<ThreadState>(pool.n_threads());
+
+  auto solve = [&](RandomStream &rng, double dt, std::size_t thread_id) {
+    auto &s = states[thread_id];
+
+    auto y0 = ic();
+    for (double &y0_i : y0) {
+      y0_i *= 1.0 + 0.1 * rng.normal();
+    }
+    s.rhs->set_rate(rng.uniform(1.5, 2.5));
+
+    s.context.reset(y0);
+    double qoi = 0.0;
+    for (double y1_i : s.context.solve(T, dt)) {
+      qoi += y1_i;
+    }
+    return qoi;
+  };
+
+  auto options = MLMCOptions{};
+  options.seed = 2024;
+
+  std::cout << "    rmse  levels       error       steps    MC steps  "
+               "savings\n";
+  for (double rmse : {1e-2, 5e-3, 2e-3, 1e-3, 5e-4, 2e-4}) {
+    auto result = mlmc(solve, T, dt_0, rmse, pool, options);
+
+    std::cout << std::setprecision(3) << std::setw(8) << rmse << std::setw(8)
+              << result.levels.size() << std::setw(12)
+              << std::abs(result.estimate - exact) << std::setw(12)
+              << result.cost << std::setw(12) << result.mc_cost
+              << std::setw(9) << result.mc_cost / result.cost << "\n";
+  }
+
+  // The samples per level of the last run show where the work goes.
+  auto result = mlmc(solve, T, dt_0, 2e-4, pool, options);
+  std::cout << "\nrmse = 2e-4:\n  level        dt   samples   V[P_l - P_l-1]\n";
+  for (std::size_t l = 0; l < result.levels.size(); ++l) {
+    std::cout << std::setw(7) << l << std::setw(10) << std::ldexp(dt_0, -int(l))
+              << std::setw(10) << result.levels[l].count << std::setw(17)
+              << result.levels[l].variance() << "\n";
+  }
+
+  return 0;
+}
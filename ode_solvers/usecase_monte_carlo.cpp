@@ -0,0 +1,136 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_monte_carlo
+//
+// Topic: A real Monte Carlo loop, reproducible on any number of threads.
+//
+// `polymorphism/usecase_odes.cpp` calls its repeated solves a Monte Carlo
+// setting, but every solve starts from `ic()`. Here each sample perturbs the
+// initial condition and the decay rate of dy/dt = -2 y randomly, solves with
+// RK4 and records the error against the exact solution. The statistics of the
+// error are computed on 1, 2, 4 and 64 threads and on one thread per core;
+// the program fails unless all of them agree bit for bit.
+
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "butcher_tableau.hpp"
+#include "exp_problem.hpp"
+#include "monte_carlo.hpp"
+#include "rhs.hpp"
+#include "solver_context.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+
+// dy/dt = -rate * y. The rate is changed between solves, hence every thread
+// needs its own instance.
+class DecayRHS : public RHS {
+public:
+  void set_rate(double rate) { this->rate = rate; }
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double /* t */) const override {
+    for (std::size_t i = 0; i < y.size(); ++i) {
+      dydt[i] = -rate * y[i];
+    }
+  }
+
+private:
+  double rate = 2.0;
+};
+
+// What each thread reuses from one sample to the next.
+struct ThreadState {
+  std::shared_ptr<DecayRHS> rhs = std::make_shared<DecayRHS>();
+  SolverContext context = SolverContext(std::make_shared<RK4Step>(rhs));
+};
+
+// The known answer of Philox4x32-10 for a zero counter and key.
+bool check_philox() {
+  auto bits = Philox4x32::generate({0, 0, 0, 0}, {0, 0});
+  return bits
+         == Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+}
+
+SampleStats run(std::size_t n_threads, std::size_t n_samples) {
+  double T = 1.0;
+  double dt = 1.0 / 64.0;
+
+  auto pool = ThreadPool(n_threads);
+  auto states = std::vector<ThreadState>(pool.n_threads());
+
+  auto sample = [&](std::size_t /* index */,
+                    RandomStream &rng,
+                    std::size_t thread_id) {
+    auto &s = states[thread_id];
+
+    // 10% noise on the initial condition, the rate in `[1.5, 2.5)`.
+    auto y0 = ic();
+    for (double &y0_i : y0) {
+      y0_i *= 1.0 + 0.1 * rng.normal();
+    }
+    double rate = rng.uniform(1.5, 2.5);
+
+    s.rhs->set_rate(rate);
+    s.context.reset(y0);
+    auto y1 = s.context.solve(T, dt);
+
+    double err = 0.0;
+    for (std::size_t i = 0; i < y1.size(); ++i) {
+      err = std::max(err, std::abs(y1[i] - y0[i] * std::exp(-rate * T)));
+    }
+    return err;
+  };
+
+  auto options = MonteCarloOptions{};
+  options.seed = 2024;
+
+  auto stats = MonteCarloStats{};
+  auto err = monte_carlo(n_samples, sample, pool, options, stats);
+
+  std::cout << std::setw(3) << pool.n_threads() << " threads: "
+            << std::setprecision(17) << "mean = " << err.mean
+            << ", std = " << std::sqrt(err.variance()) << ", max = " << err.max
+            << std::setprecision(3) << "; " << n_samples / stats.seconds
+            << " samples/s, " << stats.n_stolen << " of " << stats.n_chunks
+            << " chunks stolen\n";
+
+  return err;
+}
+
+bool is_identical(const SampleStats &a, const SampleStats &b) {
+  return a.count == b.count && a.mean == b.mean && a.m2 == b.m2
+         && a.max == b.max;
+}
+
+int main() {
+  if (!check_philox()) {
+    std::cerr << "Philox4x32-10 doesn't reproduce its known answer.\n";
+    return 1;
+  }
+
+  std::size_t n_samples = 100000;
+
+  auto reference = run(1, n_samples);
+  bool is_reproducible = true;
+  for (std::size_t n_threads :
+       {std::size_t(2),
+        std::size_t(4),
+        std::size_t(64),
+        std::size_t(std::thread::hardware_concurrency())}) {
+    is_reproducible &= is_identical(run(n_threads, n_samples), reference);
+  }
+
+  if (!is_reproducible) {
+    std::cerr << "The statistics depend on the number of threads.\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_parareal
+//
+// Topic: Parallel in time for a small state and a long time interval.
+//
+// A damped oscillator has two unknowns, too few to split between threads.
+// Parareal uses RK4 with large steps as the coarse and RK4 with small steps
+// as the fine propagator, and runs the fine propagations of the time slices
+// concurrently. The result is compared to a serial fine solve, in accuracy
+// and in time.
+//
+// Note: the speedup can't exceed the number of threads. With a single core
+// Parareal is only overhead.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "butcher_tableau.hpp"
+#include "parareal.hpp"
+#include "rhs.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
+#include "workspace.hpp"
+
+// dx/dt = v, dv/dt = -x - damping * v.
+class OscillatorRHS : public RHS {
+public:
+  explicit OscillatorRHS(double damping) : damping(damping) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double /* t */) const override {
+    dydt[0] = y[1];
+    dydt[1] = -y[0] - damping * y[1];
+  }
+
+private:
+  double damping;
+};
+
+double max_difference(const std::vector<double> &a,
+                      const std::vector<double> &b) {
+  double diff = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    diff = std::max(diff, std::abs(a[i] - b[i]));
+  }
+  return diff;
+}
+
+int main() {
+  double T = 20.0;
+  double dt_coarse = 0.1;
+  double dt_fine = 1e-5;
+
+  auto rhs = std::make_shared<OscillatorRHS>(0.1);
+  auto coarse = RK4Step(rhs);
+  auto fine = RK4Step(rhs);
+  auto y0 = std::vector<double>{1.0, 0.0};
+
+  // The same steps as Parareal takes, i.e. ending exactly at `T`.
+  auto start = std::chrono::steady_clock::now();
+  auto y_serial = y0;
+  auto buffer = std::vector<double>{};
+  propagate(fine, y_serial, buffer, 0.0, T, dt_fine, thread_local_workspace());
+  auto stop = std::chrono::steady_clock::now();
+  double serial_seconds = std::chrono::duration<double>(stop - start).count();
+  std::cout << "Serial fine solve: " << serial_seconds << " s\n";
+
+  auto pool = ThreadPool();
+  std::cout << "Parareal, " << pool.n_threads() << " threads:\n";
+
+  for (std::size_t n_slices : {pool.n_threads(), 4 * pool.n_threads()}) {
+    auto options = PararealOptions{};
+    options.n_slices = n_slices;
+    options.max_iterations = n_slices;
+    options.atol = 1e-9;
+    options.rtol = 1e-9;
+
+    auto stats = PararealStats{};
+    auto y = solve_ode_parareal(
+        coarse, dt_coarse, fine, dt_fine, y0, T, pool, options, stats);
+
+    std::cout << "  " << n_slices << " slices: " << stats.n_iterations
+              << " iterations, converged = " << stats.is_converged
+              << ", difference to serial = " << max_difference(y, y_serial)
+              << "\n    " << stats.seconds << " s (fine "
+              << stats.fine_seconds << " s, coarse " << stats.coarse_seconds
+              << " s), speedup = " << stats.speedup()
+              << ", measured = " << serial_seconds / stats.seconds << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_simd
+//
+// Topic: Explicit SIMD, picked at runtime.
+//
+// First, the kernels of every level the CPU supports are compared to the
+// plain loops, for all lengths of the masked tail. The program fails if they
+// differ by more than rounding. Then `simd_axpy` and a Forward Euler solve are
+// timed per level; once on `AlignedVector`s and once on states which are
+// deliberately misaligned by one `double`.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "simd.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "workspace.hpp"
+
+double elapsed_seconds(std::chrono::steady_clock::time_point start) {
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+std::vector<SimdLevel> supported_levels() {
+  auto levels = std::vector<SimdLevel>{SimdLevel::scalar};
+  for (auto level : {SimdLevel::avx2, SimdLevel::avx512}) {
+    if (int(level) <= int(detect_simd_level())) {
+      levels.push_back(level);
+    }
+  }
+  return levels;
+}
+
+// Returns `true` if the kernels of `level` agree with the plain loops.
+bool check_kernels(SimdLevel level) {
+  set_simd_level(level);
+
+  double max_err = 0.0;
+  for (std::size_t n = 0; n <= 20; ++n) {
+    // One extra element on either side must remain untouched.
+    auto x = std::vector<double>(n + 2);
+    auto y = std::vector<double>(n + 2);
+    for (std::size_t i = 0; i < n + 2; ++i) {
+      x[i] = std::sin(double(i) + 1.0);
+      y[i] = std::cos(double(i) + 1.0);
+    }
+
+    auto out = std::vector<double>(n + 2, -1.0);
+    // Every operand at a different offset.
+    auto inner = Span<double>(out.data() + 1, n);
+    auto x_ = Span<const double>(x.data() + 2, n);
+    auto y_ = Span<const double>(y.data(), n);
+    simd_axpy(inner, x_, 0.3, y_);
+    for (std::size_t i = 0; i < n; ++i) {
+      max_err = std::max(max_err, std::abs(inner[i] - (x_[i] + 0.3 * y_[i])));
+    }
+
+    if (out[0] != -1.0 || out[n + 1] != -1.0) {
+      std::cerr << simd_level_name(level) << ": axpy wrote out of bounds.\n";
+      return false;
+    }
+
+    simd_scale(inner, -2.0, x_);
+    for (std::size_t i = 0; i < n; ++i) {
+      max_err = std::max(max_err, std::abs(inner[i] - (-2.0 * x_[i])));
+    }
+
+    if (out[0] != -1.0 || out[n + 1] != -1.0) {
+      std::cerr << simd_level_name(level) << ": scale wrote out of bounds.\n";
+      return false;
+    }
+  }
+
+  // Fused multiply-adds round once instead of twice.
+  if (max_err > 1e-15) {
+    std::cerr << simd_level_name(level) << ": error = " << max_err << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+// Time `simd_axpy` on the `n` elements `out`, `x` and `y` point to, in
+// elements per nanosecond.
+double time_axpy(double *out, const double *x, const double *y, std::size_t n) {
+  std::size_t n_repeats = (std::size_t(1) << 28) / n;
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t r = 0; r < n_repeats; ++r) {
+    simd_axpy(Span<double>(out, n),
+              Span<const double>(x, n),
+              1e-9,
+              Span<const double>(y, n));
+  }
+  double seconds = elapsed_seconds(start);
+
+  return double(n_repeats * n) / seconds * 1e-9;
+}
+
+// Time a Forward Euler solve of `ExpRHS` on `y`, in steps per microsecond.
+double time_forward_euler(Span<double> y, AlignedVector<double> &buffer) {
+  // Without `add_scaled` Forward Euler needs two passes, both vectorized.
+  class TwoPassExpRHS : public RHS {
+  protected:
+    void do_eval(Span<double> dydt,
+                 Span<const double> y,
+                 double t) const override {
+      rhs.eval_range(dydt, y, t, 0, y.size());
+    }
+
+  private:
+    ExpRHS rhs;
+  };
+
+  auto rk_step = ForwardEulerStep(std::make_shared<TwoPassExpRHS>());
+  auto &workspace = thread_local_workspace();
+  auto observer = NullObserver{};
+
+  double T = 1.0;
+  double dt = 1.0 / 4096.0;
+
+  auto start = std::chrono::steady_clock::now();
+  solve_ode(rk_step, y, buffer, T, dt, observer, workspace);
+  double seconds = elapsed_seconds(start);
+
+  return T / dt / seconds * 1e-6;
+}
+
+int main() {
+  auto levels = supported_levels();
+  std::cout << "detected: " << simd_level_name(detect_simd_level()) << "\n";
+
+  for (auto level : levels) {
+    if (!check_kernels(level)) {
+      return 1;
+    }
+  }
+
+  // Three vectors of 32 KiB each fit into L2, i.e. the timings measure the
+  // arithmetic rather than memory bandwidth.
+  std::size_t n = 4096;
+
+  auto x = AlignedVector<double>(n + 1, 1.0);
+  auto y = AlignedVector<double>(n + 1, 2.0);
+  auto out = AlignedVector<double>(n + 1, 0.0);
+
+  std::cout << "\naxpy, elements/ns:\n";
+  for (auto level : levels) {
+    set_simd_level(level);
+    double aligned = time_axpy(out.data(), x.data(), y.data(), n);
+    double misaligned
+        = time_axpy(out.data() + 1, x.data() + 1, y.data() + 1, n);
+
+    std::cout << "  " << simd_level_name(level) << ": aligned = " << aligned
+              << ", misaligned = " << misaligned << "\n";
+  }
+
+  std::cout << "\nForward Euler, steps/us:\n";
+  for (auto level : levels) {
+    set_simd_level(level);
+
+    auto y_aligned = AlignedVector<double>(n, 1.0);
+    auto buffer = AlignedVector<double>{};
+    double aligned = time_forward_euler(y_aligned, buffer);
+
+    auto y_misaligned = AlignedVector<double>(n + 1, 1.0);
+    double misaligned = time_forward_euler(
+        Span<double>(y_misaligned.data() + 1, n), buffer);
+
+    std::cout << "  " << simd_level_name(level) << ": aligned = " << aligned
+              << ", misaligned = " << misaligned << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_solver_context
+//
+// Topic: Many short solves without touching the allocator.
+//
+// The global `operator new` is replaced by one which counts allocations.
+// First, the loop of `polymorphism/usecase_odes.cpp` is run as is. Then the
+// same solves are done with one `SolverContext` per scheme; after a warm-up
+// solve the count must not increase. The program fails if it does.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "butcher_tableau.hpp"
+#include "dormand_prince.hpp"
+#include "exp_problem.hpp"
+#include "low_storage_rk.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "solver_context.hpp"
+
+std::atomic<std::size_t> n_allocations = 0;
+
+// All replacements allocate and free through these two. If GCC could inline
+// `std::malloc` or `std::free` into the operators, it would pair them with
+// the library's sized `operator delete` and warn about mismatched allocation
+// functions.
+__attribute__((noinline)) void *counted_alloc(std::size_t size,
+                                              std::size_t alignment) {
+  n_allocations += 1;
+  // `std::aligned_alloc` requires a multiple of the alignment.
+  void *ptr = alignment == 0
+                  ? std::malloc(size == 0 ? 1 : size)
+                  : std::aligned_alloc(alignment,
+                                       (size + alignment) / alignment
+                                           * alignment);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+__attribute__((noinline)) void counted_free(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void *operator new(std::size_t size) { return counted_alloc(size, 0); }
+
+// The state and the scratch pads are `AlignedVector`s.
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return counted_alloc(size, std::size_t(alignment));
+}
+
+void operator delete(void *ptr) noexcept { counted_free(ptr); }
+void operator delete(void *ptr, std::size_t /* size */) noexcept {
+  counted_free(ptr);
+}
+void operator delete(void *ptr, std::align_val_t /* alignment */) noexcept {
+  counted_free(ptr);
+}
+void operator delete(void *ptr,
+                     std::size_t /* size */,
+                     std::align_val_t /* alignment */) noexcept {
+  counted_free(ptr);
+}
+
+double elapsed_seconds(std::chrono::steady_clock::time_point start) {
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+void print_run(const std::string &label,
+               std::size_t n_solves,
+               std::size_t allocations,
+               double seconds,
+               double err) {
+  std::cout << label << double(allocations) / double(n_solves)
+            << " allocations/solve, " << n_solves / seconds
+            << " solves/s, error = " << err << "\n";
+}
+
+// Returns `true` if the steady state doesn't allocate.
+bool with_context(const std::string &label,
+                  std::shared_ptr<const RKStep> rk_step,
+                  std::size_t n_solves,
+                  double T,
+                  double dt) {
+  auto y0 = ic();
+  auto y_exact = soln(T);
+
+  auto context = SolverContext(std::move(rk_step));
+  context.reset(y0);
+  context.solve(T, dt);
+
+  std::size_t allocations_before = n_allocations;
+  auto start = std::chrono::steady_clock::now();
+
+  double err = 0.0;
+  for (std::size_t s = 0; s < n_solves; ++s) {
+    context.reset(y0);
+    auto y1 = context.solve(T, dt);
+    for (std::size_t i = 0; i < y1.size(); ++i) {
+      err = std::max(err, std::abs(y1[i] - y_exact[i]));
+    }
+  }
+
+  double seconds = elapsed_seconds(start);
+  std::size_t allocations = n_allocations - allocations_before;
+  print_run(label, n_solves, allocations, seconds, err);
+
+  return allocations == 0;
+}
+
+int main() {
+  std::size_t n_solves = 1000000;
+  double T = 0.1;
+  double dt = 0.01;
+
+  {
+    std::size_t allocations_before = n_allocations;
+    auto start = std::chrono::steady_clock::now();
+
+    double err = 0.0;
+    for (std::size_t s = 0; s < n_solves; ++s) {
+      auto y0 = ic();
+      auto rhs = std::make_shared<ExpRHS>();
+      auto rk_step = ForwardEulerStep(rhs);
+
+      auto y1 = solve_ode(rk_step, y0, T, dt);
+      err = std::max(err, max_error(y1, soln(T)));
+    }
+
+    print_run("Forward Euler, tutorial loop: ",
+              n_solves,
+              n_allocations - allocations_before,
+              elapsed_seconds(start),
+              err);
+  }
+
+  auto rhs = std::make_shared<ExpRHS>();
+  bool is_allocation_free
+      = with_context("Forward Euler, context:       ",
+                     std::make_shared<ForwardEulerStep>(rhs),
+                     n_solves,
+                     T,
+                     dt);
+
+  auto low_storage = std::make_shared<LowStorageRKStep>(
+      rhs, carpenter_kennedy_rk4_tableau());
+  is_allocation_free &= with_context(
+      "Low-storage RK4, context:     ", low_storage, n_solves, T, dt);
+
+  is_allocation_free &= with_context("RK4, context:                 ",
+                                     std::make_shared<RK4Step>(rhs),
+                                     n_solves,
+                                     T,
+                                     dt);
+
+  is_allocation_free &= with_context("Dormand-Prince, context:      ",
+                                     std::make_shared<DormandPrinceStep>(rhs),
+                                     n_solves,
+                                     T,
+                                     dt);
+
+  if (!is_allocation_free) {
+    std::cerr << "A context allocated after the warm-up.\n";
+    return 1;
+  }
+
+  return 0;
+}
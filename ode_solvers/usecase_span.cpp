@@ -0,0 +1,106 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_span
+//
+// Topic: Integrating state which isn't owned by a `std::vector`.
+//
+// The state lives in a buffer owned by someone else: a C style allocation,
+// one field of a struct of arrays and a memory mapped file. First, the
+// vector interface is used, i.e. the state is copied into a vector and the
+// result copied back. Then `solve_ode` integrates the buffer in place through
+// a `Span`, see `span.hpp`.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "low_storage_rk.hpp"
+#include "mapped_file.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+
+// Largest error w.r.t. the exact solution of dy/dt = -2 y, y(0) = 1.
+double max_error(Span<const double> y, double T) {
+  double y_exact = std::exp(-2.0 * T);
+  double err = 0.0;
+  for (double y_i : y) {
+    err = std::max(err, std::abs(y_i - y_exact));
+  }
+  return err;
+}
+
+template <class F>
+double time_seconds(const F &f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+void print_run(const std::string &label,
+               double seconds,
+               Span<const double> y,
+               double T) {
+  std::cout << "  " << label << seconds
+            << " s, error = " << max_error(y, T) << "\n";
+}
+
+int main() {
+  std::size_t n_vars = std::size_t(1) << 22;
+  double T = 0.01;
+  double dt = 1e-3;
+  auto rhs = std::make_shared<ExpRHS>();
+  auto rk_step = ForwardEulerStep(rhs);
+
+  {
+    std::cout << "A buffer allocated by a C library:\n";
+    auto deleter = [](double *p) { std::free(p); };
+    auto buffer = std::unique_ptr<double, decltype(deleter)>(
+        static_cast<double *>(std::malloc(n_vars * sizeof(double))), deleter);
+    auto y = Span<double>(buffer.get(), n_vars);
+    std::fill(y.begin(), y.end(), 1.0);
+
+    double seconds = time_seconds([&]() {
+      auto y_copy = std::vector<double>(y.begin(), y.end());
+      y_copy = solve_ode(rk_step, std::move(y_copy), T, dt);
+      std::copy(y_copy.begin(), y_copy.end(), y.begin());
+    });
+    print_run("copy in/out: ", seconds, y, T);
+
+    std::fill(y.begin(), y.end(), 1.0);
+    seconds = time_seconds([&]() { solve_ode(rk_step, y, T, dt); });
+    print_run("in place:    ", seconds, y, T);
+  }
+
+  {
+    std::cout << "One field of a struct of arrays:\n";
+    std::size_t n_fields = 4;
+    auto fields = std::vector<double>(n_fields * n_vars, 1.0);
+
+    // Only field 2 evolves, the others are left untouched.
+    auto y = Span<double>(fields).subspan(2 * n_vars, n_vars);
+    double seconds = time_seconds([&]() { solve_ode(rk_step, y, T, dt); });
+    print_run("in place:    ", seconds, y, T);
+  }
+
+  {
+    // A low-storage step advances in place, i.e. there's no second buffer.
+    std::cout << "A memory mapped file, low-storage RK4:\n";
+    auto file = MappedFile::create("state.bin", n_vars * sizeof(double));
+    auto y = Span<double>(static_cast<double *>(file.data()), n_vars);
+    std::fill(y.begin(), y.end(), 1.0);
+
+    auto low_storage = LowStorageRKStep(rhs, carpenter_kennedy_rk4_tableau());
+    double seconds
+        = time_seconds([&]() { solve_ode(low_storage, y, T, dt); });
+    print_run("in place:    ", seconds, y, T);
+  }
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_static_dispatch
+//
+// Topic: Virtual vs. compile time dispatch of the RHS and the RK step.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ode_solver.hpp"
+
+// Time `n_solves` solves, the state has `n_vars` variables. The best of a few
+// repetitions, the shortest runs take about a millisecond.
+void time_solver(const std::string &label,
+                 const ODESolver &solver,
+                 std::size_t n_vars,
+                 std::size_t n_solves,
+                 double T,
+                 double dt) {
+  auto y0 = std::vector<double>(n_vars, 1.0);
+
+  double seconds = std::numeric_limits<double>::infinity();
+  double checksum = 0.0;
+  for (int r = 0; r < 5; ++r) {
+    checksum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t s = 0; s < n_solves; ++s) {
+      checksum += solver.solve(y0, T, dt)[0];
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(stop - start).count();
+    seconds = std::min(seconds, elapsed);
+  }
+
+  // Print something which depends on the result, such that the compiler can't
+  // skip the work.
+  std::cout << "  " << label << ": " << seconds << " s (checksum " << checksum
+            << ")\n";
+}
+
+int main() {
+  double T = 1.0;
+  double dt = 0.01;
+
+  // Keep the total work constant.
+  std::size_t work = std::size_t(1) << 24;
+
+  // The static kernel inlines the RHS into the update. That matters for tiny
+  // states, where the virtual calls dominate. For larger ones the virtual
+  // `ExpRHS` is fused and vectorized too, and both are equally fast.
+  for (std::size_t n_vars : {3, 1000, 1000000}) {
+    std::size_t n_solves = std::max(work / (n_vars * 100), std::size_t(1));
+
+    auto dynamic_solver = DynamicODESolver(
+        make_rk_step("forward_euler", make_rhs("exp")));
+    auto static_solver = make_ode_solver("forward_euler", "exp");
+
+    std::cout << "n_vars = " << n_vars << "\n";
+    time_solver("virtual", dynamic_solver, n_vars, n_solves, T, dt);
+    time_solver("static ", *static_solver, n_vars, n_solves, T, dt);
+  }
+
+  // Without a pre-instantiated kernel, the factory falls back to virtual.
+  for (std::string scheme : {"forward_euler", "rk4"}) {
+    auto solver = make_ode_solver(scheme, "exp");
+    std::cout << scheme << " for exp: "
+              << (solver->is_static() ? "static" : "virtual") << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_stiff
+//
+// Topic: Explicit vs. implicit time stepping for a stiff problem.
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "counting_rhs.hpp"
+#include "exp_problem.hpp"
+#include "implicit.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "stiff_problem.hpp"
+#include "workspace.hpp"
+
+// Hides the Jacobian of a RHS, i.e. forces finite differences.
+class WithoutJacobian : public RHS {
+public:
+  explicit WithoutJacobian(std::shared_ptr<RHS> rhs) : rhs(std::move(rhs)) {}
+
+protected:
+  void do_eval(Span<double> dydt,
+               Span<const double> y,
+               double t) const override {
+    (*rhs)(dydt, y, t);
+  }
+
+private:
+  std::shared_ptr<RHS> rhs;
+};
+
+void print_run(const std::string &label,
+               const std::vector<double> &y1,
+               const std::vector<double> &y_exact,
+               double T,
+               double dt,
+               const CountingRHS &rhs) {
+  std::cout << label << ": error = " << max_error(y1, y_exact)
+            << ", steps = " << T / dt << ", RHS evals = " << rhs.count();
+}
+
+void print_newton(const NewtonStats &stats) {
+  std::cout << ", Newton iterations = " << stats.n_iterations
+            << ", Jacobians = " << stats.n_jacobians
+            << ", LU = " << stats.n_factorizations << "\n";
+}
+
+int main() {
+  std::size_t n_vars = 10;
+  double T = 1.0;
+
+  auto lambda = stiff_decay_rates(n_vars, 1e6);
+  auto y0 = std::vector<double>(n_vars, 2.0);
+  auto y_exact = stiff_soln(lambda, y0, T);
+  auto stiff_rhs = std::make_shared<ProtheroRobinsonRHS>(lambda);
+
+  {
+    // Stability requires `dt < 2e-6`.
+    double dt = 1e-6;
+    auto rhs = std::make_shared<CountingRHS>(stiff_rhs);
+    auto y1 = solve_ode(ForwardEulerStep(rhs), y0, T, dt);
+    print_run("Forward Euler    ", y1, y_exact, T, dt, *rhs);
+    std::cout << "\n";
+  }
+
+  for (double dt : {1e-2, 1e-3}) {
+    auto rhs = std::make_shared<CountingRHS>(stiff_rhs);
+    auto rk_step = BackwardEulerStep(rhs);
+
+    auto workspace = Workspace{};
+    auto y1 = solve_ode(rk_step, y0, T, dt, workspace);
+    print_run("Backward Euler   ", y1, y_exact, T, dt, *rhs);
+    print_newton(rk_step.newton_stats(workspace));
+  }
+
+  {
+    double dt = 1e-2;
+    auto rhs = std::make_shared<CountingRHS>(
+        std::make_shared<WithoutJacobian>(stiff_rhs));
+    auto rk_step = BackwardEulerStep(rhs);
+
+    auto workspace = Workspace{};
+    auto y1 = solve_ode(rk_step, y0, T, dt, workspace);
+    print_run("Backward Euler FD", y1, y_exact, T, dt, *rhs);
+    print_newton(rk_step.newton_stats(workspace));
+  }
+
+  // BDF2 starts with a Backward Euler step, that's still second order: halving
+  // `dt` quarters the error.
+  for (int order = 1; order <= 2; ++order) {
+    for (double dt : {1e-2, 5e-3}) {
+      auto rhs = std::make_shared<CountingRHS>(stiff_rhs);
+      auto rk_step = BDFStep(rhs, order);
+
+      auto workspace = Workspace{};
+      auto y1 = solve_ode(rk_step, y0, T, dt, workspace);
+      print_run("BDF" + std::to_string(order) + "             ",
+                y1,
+                y_exact,
+                T,
+                dt,
+                *rhs);
+      print_newton(rk_step.newton_stats(workspace));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_threads
+//
+// Topic: Forward Euler on a large state vector: two pass vs. fused, serial
+// vs. multithreaded.
+//
+// Multithreaded runs are timed twice. Once with the state in a
+// `std::vector`, which the main thread writes first. Then with the state,
+// scratch and buffer first written by the thread which owns the chunk, see
+// `threaded.hpp`. On a machine with several NUMA nodes only the latter
+// spreads the memory over all nodes.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "span.hpp"
+#include "threaded.hpp"
+#include "workspace.hpp"
+
+// Same as `ExpRHS` but without the fused update.
+class TwoPassExpRHS : public RangeRHS {
+protected:
+  void do_eval_range(Span<double> dydt,
+                     Span<const double> y,
+                     double /* t */,
+                     std::size_t begin,
+                     std::size_t end) const override {
+    for (std::size_t i = begin; i < end; ++i) {
+      dydt[i] = -2.0 * y[i];
+    }
+  }
+};
+
+void time_step(const std::string &label,
+               const RKStep &rk_step,
+               const std::vector<double> &y0,
+               double T,
+               double dt) {
+  auto start = std::chrono::steady_clock::now();
+  auto y1 = solve_ode(rk_step, y0, T, dt);
+  auto stop = std::chrono::steady_clock::now();
+
+  std::cout << label << ": "
+            << std::chrono::duration<double>(stop - start).count()
+            << " s (y1[0] = " << y1[0] << ")\n";
+}
+
+// Same as above, with the state, the buffer and the scratch of the step each
+// first written by the threads of `execution`.
+void time_first_touch(const std::string &label,
+                      const RKStep &rk_step,
+                      const ThreadedExecution &execution,
+                      const std::vector<double> &y0,
+                      double T,
+                      double dt) {
+  // Fresh, otherwise the pages were placed by an earlier run.
+  auto workspace = Workspace{};
+  auto buffer = AlignedVector<double>{};
+  auto observer = NullObserver{};
+
+  auto start = std::chrono::steady_clock::now();
+  auto y = execution.make_vector(Span<const double>(y0));
+  solve_ode(rk_step, Span<double>(y), buffer, T, dt, observer, workspace);
+  auto stop = std::chrono::steady_clock::now();
+
+  std::cout << label << ": "
+            << std::chrono::duration<double>(stop - start).count()
+            << " s (y1[0] = " << y[0] << ")\n";
+}
+
+int main() {
+  std::size_t n_vars = std::size_t(1) << 23;
+  double T = 0.1;
+  double dt = 0.01;
+
+  auto y0 = std::vector<double>(n_vars, 1.0);
+  auto rhs = std::make_shared<ExpRHS>();
+
+  auto two_pass_rhs = std::make_shared<TwoPassExpRHS>();
+  time_step("two pass  ", ForwardEulerStep(two_pass_rhs), y0, T, dt);
+  time_step("fused     ", ForwardEulerStep(rhs), y0, T, dt);
+
+  std::size_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  for (std::size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    // One pool, shared by every step.
+    auto pool = std::make_shared<ThreadPool>(n_threads);
+    auto execution = ThreadedExecution(pool);
+    auto rk_step = ThreadedForwardEulerStep(rhs, execution);
+
+    auto label = "threads = " + std::to_string(n_threads);
+    time_step(label, rk_step, y0, T, dt);
+    time_first_touch(label + ", first touch", rk_step, execution, y0, T, dt);
+  }
+
+  return 0;
+}
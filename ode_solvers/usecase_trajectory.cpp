@@ -0,0 +1,49 @@
+// Compile with (see the Makefile for suitable `CXXFLAGS`)
+//     make usecase_trajectory
+//
+// Topic: Streaming a trajectory to a memory mapped file and reading it back.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "exp_problem.hpp"
+#include "rhs.hpp"
+#include "rk_step.hpp"
+#include "solve_ode.hpp"
+#include "trajectory.hpp"
+
+int main() {
+  double T = 1.0;
+  double dt = 0.001;
+  std::size_t every = 100;
+  std::string filename = "trajectory.bin";
+
+  auto y0 = ic();
+  auto rk_step = ForwardEulerStep(std::make_shared<ExpRHS>());
+
+  {
+    auto writer = TrajectoryWriter(
+        filename, y0.size(), trajectory_capacity(T, dt, every), every);
+    solve_ode(rk_step, y0, T, dt, writer);
+
+    std::cout << "wrote " << writer.n_records() << " records\n";
+  }
+
+  // Possibly in a different program.
+  auto reader = TrajectoryReader(filename);
+  for (std::size_t k = 0; k < reader.n_records(); ++k) {
+    double t = reader.time(k);
+    const double *y = reader.state(k);
+    auto y_exact = soln(t);
+
+    double err = 0.0;
+    for (std::size_t i = 0; i < reader.n_vars(); ++i) {
+      err = std::max(err, std::abs(y[i] - y_exact[i]));
+    }
+    std::cout << "t = " << t << ": error = " << err << "\n";
+  }
+
+  return 0;
+}
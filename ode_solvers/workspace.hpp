@@ -0,0 +1,125 @@
+#pragma once
+
+// A `mutable` scratch pad makes a `const` method unsafe to call from two
+// threads at the same time, see `polymorphism/usecase_odes.cpp`. The way out
+// is to not store scratch pads in the object. Instead the caller lends a
+// `Workspace` to `RKStep::advance`. If each thread uses its own workspace,
+// one immutable step can be shared by all threads.
+//
+// Passing the workspace explicitly is the most transparent. For convenience
+// every thread also has its own `thread_local_workspace()`.
+//
+// Some steps need state which persists from one step to the next, e.g. a
+// factorized Jacobian or the history of a multistep method. It's state of the
+// trajectory being computed, not of the step. Hence, it too lives in the
+// workspace.
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include "aligned_vector.hpp"
+
+/// Scratch pads for one thread.
+///
+/// The vectors are only allocated the first time they're requested (or if
+/// they need to grow). Their content is unspecified, i.e. whoever borrows
+/// them must write before reading. Code which is lent a workspace may use any
+/// slot. Therefore, callers must not keep references into a workspace they're
+/// passing on.
+class Workspace {
+public:
+  /// The scratch pad in slot `slot`, resized to `n` elements.
+  ///
+  /// Every scalar type has its own slots, e.g. `vector<float>(0, n)` and
+  /// `vector<double>(0, n)` are different vectors. The data is aligned for
+  /// SIMD, see `AlignedVector`.
+  template <class Scalar = double>
+  AlignedVector<Scalar> &vector(std::size_t slot, std::size_t n) {
+    auto &buffers = this->buffers<Scalar>();
+    if (slot >= buffers.size()) {
+      buffers.resize(slot + 1);
+    }
+
+    auto &buffer = buffers[slot];
+    if (buffer.size() != n) {
+      buffer.resize(n);
+    }
+
+    return buffer;
+  }
+
+  /// The persistent state of type `T` in slot `slot`.
+  ///
+  /// If the slot is empty or holds a different type, it's replaced by a
+  /// default constructed `T`. Several objects of the same type may share a
+  /// workspace, therefore owners need to record in the state who they are,
+  /// see `make_workspace_owner_id`.
+  template <class T>
+  T &state(std::size_t slot) {
+    if (slot >= states.size()) {
+      states.resize(slot + 1);
+    }
+
+    auto &s = states[slot];
+    if (s.type == nullptr || *s.type != typeid(T)) {
+      s.ptr = std::make_shared<T>();
+      s.type = &typeid(T);
+    }
+
+    return *static_cast<T *>(s.ptr.get());
+  }
+
+private:
+  // A `std::deque` doesn't move its elements when it grows at the end. Hence,
+  // requesting a new slot doesn't invalidate references to other slots.
+  template <class Scalar>
+  using Buffers = std::deque<AlignedVector<Scalar>>;
+
+  template <class Scalar>
+  Buffers<Scalar> &buffers() {
+    if constexpr (std::is_same_v<Scalar, double>) {
+      return double_buffers;
+    } else if constexpr (std::is_same_v<Scalar, float>) {
+      return float_buffers;
+    } else {
+      // Anything else, e.g. extended precision, is rare enough to be looked
+      // up by type.
+      for (auto &b : other_buffers) {
+        if (*b.type == typeid(Scalar)) {
+          return *static_cast<Buffers<Scalar> *>(b.ptr.get());
+        }
+      }
+
+      auto ptr = std::make_shared<Buffers<Scalar>>();
+      other_buffers.push_back({&typeid(Scalar), ptr});
+      return *ptr;
+    }
+  }
+
+  struct State {
+    const std::type_info *type = nullptr;
+    std::shared_ptr<void> ptr;
+  };
+
+  Buffers<double> double_buffers;
+  Buffers<float> float_buffers;
+  std::vector<State> other_buffers;
+  std::vector<State> states;
+};
+
+/// A new number on every call; identifies the owner of state in a workspace.
+inline std::size_t make_workspace_owner_id() {
+  static std::atomic<std::size_t> next_id = 1;
+  return next_id++;
+}
+
+/// The workspace of the calling thread.
+inline Workspace &thread_local_workspace() {
+  thread_local Workspace workspace;
+  return workspace;
+}
@@ -178,6 +178,11 @@ int main() {
   // For teaching purposes, we will solve the same ODE several times. This
   // either resembles a Monte Carlo setting, or because solving the ODE is only
   // one part of some more compilicated algorithm.
+  //
+  // If you need to do this a million times, see `ode_solvers/` for how to make
+  // it fast, e.g. `ode_solvers/usecase_ensemble.cpp` or
+  // `ode_solvers/usecase_solver_context.cpp`; and
+  // `ode_solvers/usecase_monte_carlo.cpp` for random samples on many threads.
   for (int i = 0; i < 3; ++i) {
     auto y0 = ic();
 